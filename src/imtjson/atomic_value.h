@@ -0,0 +1,196 @@
+#pragma once
+
+#ifdef IMTJSON_NON_ATOMIC_REFCOUNT
+#error "AtomicValue shares values between threads, it can't be used with IMTJSON_NON_ATOMIC_REFCOUNT"
+#endif
+
+#include "value.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace json {
+
+namespace _details {
+
+///Epoch based protection of readers
+/**
+ * Every thread has a slot in which it announces the epoch observed when it started
+ * reading. An object retired in epoch E can be released when there is no active
+ * reader which observed an epoch lower than E.
+ */
+class EpochDomain {
+public:
+
+    struct Slot {
+        //observed epoch, 0 - thread is not reading
+        std::atomic<std::uint64_t> epoch = 0;
+        std::atomic<bool> used = true;
+        Slot *next = nullptr;
+    };
+
+    static EpochDomain &instance() {
+        //never destroyed, threads can exit during static destruction
+        static EpochDomain *inst = new EpochDomain;
+        return *inst;
+    }
+
+    ///Retrieve slot of the current thread
+    Slot &local() {
+        static thread_local SlotHolder holder;
+        if (!holder.slot) holder.slot = acquire_slot();
+        return *holder.slot;
+    }
+
+    void enter(Slot &s) {
+        s.epoch.store(_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+    void leave(Slot &s) {
+        s.epoch.store(0, std::memory_order_release);
+    }
+
+    ///Start new epoch
+    /** @return new epoch */
+    std::uint64_t advance() {
+        return _epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+    }
+
+    ///Retrieve lowest epoch observed by active readers
+    std::uint64_t min_active() const {
+        std::uint64_t r = std::numeric_limits<std::uint64_t>::max();
+        for (Slot *s = _slots.load(std::memory_order_acquire); s; s = s->next) {
+            std::uint64_t e = s->epoch.load(std::memory_order_seq_cst);
+            if (e && e < r) r = e;
+        }
+        return r;
+    }
+
+protected:
+
+    EpochDomain() = default;
+
+    struct SlotHolder {
+        Slot *slot = nullptr;
+        ~SlotHolder() {
+            //slot is never released, it is reused by other thread
+            if (slot) slot->used.store(false, std::memory_order_release);
+        }
+    };
+
+    std::atomic<std::uint64_t> _epoch = 1;
+    std::atomic<Slot *> _slots = nullptr;
+
+    Slot *acquire_slot() {
+        for (Slot *s = _slots.load(std::memory_order_acquire); s; s = s->next) {
+            bool expected = false;
+            if (s->used.compare_exchange_strong(expected, true, std::memory_order_acquire)) return s;
+        }
+        Slot *s = new Slot;
+        s->next = _slots.load(std::memory_order_relaxed);
+        while (!_slots.compare_exchange_weak(s->next, s, std::memory_order_release, std::memory_order_relaxed));
+        return s;
+    }
+};
+
+}
+
+///Holds a value, which can be read and replaced by multiple threads
+/**
+ * Reading is wait-free, it never blocks a reader and never waits on a writer. The
+ * reader receives a copy of the current value. Because containers are immutable,
+ * the copy can be used for any time without further synchronization.
+ *
+ * Publishing a new value is atomic. Writers are serialized by a mutex. The previous
+ * value is released when there is no reader, which could still access it
+ * (epoch based reclamation). Old values are checked and released during
+ * each publishing and by reclaim()
+ *
+ * @note Reference counters of shared values are still updated by readers. Use
+ * freeze() on the published value to avoid this for read-mostly data
+ */
+class AtomicValue {
+public:
+
+    AtomicValue():AtomicValue(Value()) {}
+    AtomicValue(Value v):_cur(new Node{std::move(v)}) {}
+    AtomicValue(const AtomicValue &) = delete;
+    AtomicValue &operator=(const AtomicValue &) = delete;
+    ~AtomicValue() {
+        delete _cur.load(std::memory_order_relaxed);
+        for (auto &r: _retired) delete r.first;
+    }
+
+    ///Retrieve current value
+    Value load() const {
+        auto &dom = _details::EpochDomain::instance();
+        auto &slot = dom.local();
+        dom.enter(slot);
+        Value out = _cur.load(std::memory_order_seq_cst)->value;
+        dom.leave(slot);
+        return out;
+    }
+
+    operator Value() const {return load();}
+
+    ///Publish new value
+    void store(Value v) {
+        exchange(std::move(v));
+    }
+
+    AtomicValue &operator=(Value v) {
+        store(std::move(v));
+        return *this;
+    }
+
+    ///Publish new value
+    /**
+     * @param v new value
+     * @return previous value
+     */
+    Value exchange(Value v) {
+        Node *n = new Node{std::move(v)};
+        std::lock_guard _(_mx);
+        Node *old = _cur.exchange(n, std::memory_order_seq_cst);
+        Value out = old->value;
+        _retired.emplace_back(old, _details::EpochDomain::instance().advance());
+        reclaim_lk();
+        return out;
+    }
+
+    ///Release previous values, which are no longer accessible by readers
+    /**
+     * @return count of previous values which are still waiting
+     */
+    std::size_t reclaim() {
+        std::lock_guard _(_mx);
+        return reclaim_lk();
+    }
+
+protected:
+
+    struct Node {
+        Value value;
+    };
+
+    std::atomic<Node *> _cur;
+    std::mutex _mx;
+    std::vector<std::pair<Node *, std::uint64_t> > _retired;
+
+    std::size_t reclaim_lk() {
+        std::uint64_t m = _details::EpochDomain::instance().min_active();
+        auto iter = std::remove_if(_retired.begin(), _retired.end(), [&](const auto &r){
+            if (r.second > m) return false;
+            delete r.first;
+            return true;
+        });
+        _retired.erase(iter, _retired.end());
+        return _retired.size();
+    }
+};
+
+}
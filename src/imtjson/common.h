@@ -18,6 +18,9 @@ namespace BinaryType {
     constexpr unsigned char bool_true = 0x01;
     constexpr unsigned char bool_false = 0x02;
     constexpr unsigned char double_number = 0x03;
+    constexpr unsigned char indefinite_array = 0x04;
+    constexpr unsigned char indefinite_object = 0x05;
+    constexpr unsigned char container_end = 0x06;
     constexpr unsigned char undefined = 0x07;
 
     constexpr unsigned char p_number = 0x10;
@@ -26,6 +29,19 @@ namespace BinaryType {
     constexpr unsigned char string_number = 0x28;
     constexpr unsigned char array = 0x30;
     constexpr unsigned char object = 0x38;
+    constexpr unsigned char reference = 0x40;
+    ///header of a stream which can contain references
+    constexpr unsigned char shared_refs = 0x48;
+};
+
+///Controls detection of shared containers during binary serialization
+enum class SharedRefs: unsigned char {
+    ///every container is written in full
+    none,
+    ///repeated occurrence of the same container instance is written as reference
+    same_instance,
+    ///containers with identical content are also written as reference
+    same_content
 };
 
 
@@ -0,0 +1,392 @@
+#pragma once
+
+#include "serializer.h"
+#include "parser.h"
+
+#include <array>
+
+namespace json {
+
+///Block compression of binary streams
+/**
+ * The stream is split to blocks. Every block starts by the header which has the same
+ * layout as header of binary value (tag + size of length, then the length). The tag
+ * specifies type of the block
+ *
+ * Blocks are independent, so compressor and decompressor need to hold only one block
+ */
+namespace BlockType {
+    ///block contains uncompressed data
+    constexpr unsigned char stored = 0x00;
+    ///block contains LZ compressed data
+    constexpr unsigned char compressed = 0x08;
+}
+
+///LZ compression of a single block
+/**
+ * The compressed block is sequence of commands. Each command starts by a token
+ * (high 4 bits - count of literals, low 4 bits - length of match - 4). Value 15
+ * means, that length continues in following bytes (sum of bytes until byte != 255).
+ * Token is followed by literals, then by 2 bytes offset (little endian) and extra length
+ * of the match. Last command contains only literals.
+ */
+class BlockCompressor {
+public:
+
+    ///Maximum distance of match
+    static constexpr std::size_t max_offset = 65535;
+    ///Minimal length of match
+    static constexpr std::size_t min_match = 4;
+
+    ///Compress block
+    /**
+     * @param data data to compress
+     * @return framed block (compressed or stored, if compression doesn't help). Returned
+     * string is valid until next call
+     */
+    std::string_view compress(std::string_view data);
+
+protected:
+    static constexpr unsigned int hash_bits = 12;
+    std::array<std::uint32_t, 1U << hash_bits> _table;
+    std::vector<char> _buffer;
+    std::vector<char> _out;
+
+    static std::uint32_t read32(const char *ptr) {
+        std::uint32_t v;
+        std::memcpy(&v, ptr, sizeof(v));
+        return v;
+    }
+    static unsigned int hash(std::uint32_t v) {
+        return (v * 2654435761U) >> (32 - hash_bits);
+    }
+    void write_length(std::size_t len);
+    void write_sequence(const char *lit, std::size_t lit_len, std::size_t offset, std::size_t match_len);
+};
+
+///Decompression of blocks generated by BlockCompressor
+class BlockDecompressor {
+public:
+
+    ///Construct decompressor
+    /**
+     * @param max_block_size maximum allowed size of decompressed block. Larger blocks
+     * are reported as error
+     */
+    BlockDecompressor(std::size_t max_block_size = 1024*1024):_max_block_size(max_block_size) {}
+
+    ///Write data to decompressor
+    /**
+     * @param data compressed data
+     * @param fn function called for every decompressed block. The function receives
+     * std::string_view and returns bool. Returns false to stop processing
+     * @retval true need more data
+     * @retval false processing stopped (because error or because callback requested it).
+     */
+    template<std::invocable<std::string_view> Fn>
+    bool write(std::string_view data, Fn &&fn);
+
+    ///Retrieve error status
+    bool is_error() const {return _is_error;}
+
+    ///Retrieve unprocessed data when write returned false
+    std::string_view get_unprocessed_data() const {return _unprocessed;}
+
+    ///Decompress one block
+    /**
+     * @param data content of the block (without header)
+     * @param out output buffer, decompressed data are appended
+     * @param limit maximum size of decompressed data
+     * @retval true success
+     * @retval false corrupted data
+     */
+    static bool decompress(std::string_view data, std::vector<char> &out, std::size_t limit);
+
+protected:
+    std::size_t _max_block_size;
+    std::vector<char> _block;
+    std::vector<char> _out;
+    std::string_view _unprocessed;
+    unsigned char _type = 0;
+    unsigned char _len_bytes = 0;
+    std::size_t _len = 0;
+    bool _header = true;
+    bool _is_error = false;
+};
+
+///Binary serializer which compresses its output
+/**
+ * Works the same way as BinarySerializer, but output is split to blocks, which
+ * are compressed
+ */
+class CompressedSerializer {
+public:
+    ///Construct serializer
+    /**
+     * @param v value to serialize
+     * @param refs shared references (see BinarySerializer)
+     * @param block_size size of block to compress. Larger block can lead to better
+     * compression ratio, but requires more memory. Blocks larger than 1MB must be
+     * parsed with increased max_block_size of the CompressedParser
+     */
+    CompressedSerializer(Value v, SharedRefs refs = SharedRefs::none, std::size_t block_size = 65536)
+        :_ser(std::move(v), refs), _block_size(block_size) {}
+
+    ///Read serialized content
+    /**
+     * @return next compressed block. If empty string is returned, everything
+     * is serialized
+     */
+    std::string_view read();
+
+protected:
+    BinarySerializer _ser;
+    BlockCompressor _compressor;
+    std::size_t _block_size;
+    std::string_view _pending;
+    std::vector<char> _block;
+};
+
+///Binary parser which reads compressed stream
+template<ValuePreprocessor Fn = ParserEmptyPreprocesor>
+class CompressedParser {
+public:
+    ///Construct parser
+    /**
+     * @param max_block_size maximum allowed size of decompressed block, it must be
+     * at least block_size used by the CompressedSerializer
+     */
+    CompressedParser(std::size_t max_block_size = 1024*1024):_decompressor(max_block_size) {}
+    CompressedParser(Fn preprocFn, std::size_t max_block_size = 1024*1024)
+        :_decompressor(max_block_size), _parser(std::move(preprocFn)) {}
+
+    ///Write some data to the parser
+    /**
+     * @param text compressed data
+     * @retval true need more data
+     * @retval false parsing is done, you can get result/error
+     */
+    bool write(std::string_view text);
+    ///Retrieve error status
+    bool is_error() const {return _decompressor.is_error() || _parser.is_error();}
+    ///Retrieve parsed result
+    Value get_result() {return _parser.get_result();}
+    ///Retrieve unprocessed data (part of compressed stream after the last processed block)
+    std::string_view get_unprocessed_data() const {return _decompressor.get_unprocessed_data();}
+
+protected:
+    BlockDecompressor _decompressor;
+    Parser<Fn, Format::binary> _parser;
+    bool _done = false;
+};
+
+inline void BlockCompressor::write_length(std::size_t len) {
+    while (len >= 255) {
+        _buffer.push_back(static_cast<char>(255));
+        len -= 255;
+    }
+    _buffer.push_back(static_cast<char>(len));
+}
+
+inline void BlockCompressor::write_sequence(const char *lit, std::size_t lit_len, std::size_t offset, std::size_t match_len) {
+    std::size_t ml = match_len?match_len - min_match:0;
+    unsigned char token = static_cast<unsigned char>((std::min<std::size_t>(lit_len, 15) << 4) | std::min<std::size_t>(ml, 15));
+    _buffer.push_back(static_cast<char>(token));
+    if (lit_len >= 15) write_length(lit_len - 15);
+    _buffer.insert(_buffer.end(), lit, lit + lit_len);
+    if (match_len) {
+        _buffer.push_back(static_cast<char>(offset & 0xFF));
+        _buffer.push_back(static_cast<char>(offset >> 8));
+        if (ml >= 15) write_length(ml - 15);
+    }
+}
+
+inline std::string_view BlockCompressor::compress(std::string_view data) {
+    _buffer.clear();
+    _out.clear();
+    const char *beg = data.data();
+    std::size_t sz = data.size();
+    std::size_t anchor = 0;
+    std::size_t pos = 0;
+    if (sz > min_match) {
+        _table.fill(0);
+        //positions in the table are stored +1, zero means empty
+        std::size_t limit = sz - min_match;
+        while (pos <= limit) {
+            std::uint32_t seq = read32(beg + pos);
+            auto &slot = _table[hash(seq)];
+            std::size_t cand = slot;
+            slot = static_cast<std::uint32_t>(pos + 1);
+            if (cand && pos + 1 - cand <= max_offset && read32(beg + cand - 1) == seq) {
+                --cand;
+                std::size_t len = min_match;
+                while (pos + len < sz && beg[cand + len] == beg[pos + len]) ++len;
+                write_sequence(beg + anchor, pos - anchor, pos - cand, len);
+                pos += len;
+                anchor = pos;
+            } else {
+                ++pos;
+            }
+        }
+    }
+    write_sequence(beg + anchor, sz - anchor, 0, 0);
+    auto out = std::back_inserter(_out);
+    if (_buffer.size() < sz) {
+        render_binary_type_size(BlockType::compressed, _buffer.size(), out);
+        _out.insert(_out.end(), _buffer.begin(), _buffer.end());
+    } else {
+        render_binary_type_size(BlockType::stored, sz, out);
+        _out.insert(_out.end(), data.begin(), data.end());
+    }
+    return std::string_view(_out.data(), _out.size());
+}
+
+inline bool BlockDecompressor::decompress(std::string_view data, std::vector<char> &out, std::size_t limit) {
+    auto read_length = [&](std::size_t &pos, std::size_t &len) {
+        unsigned char b;
+        do {
+            if (pos >= data.size()) return false;
+            b = static_cast<unsigned char>(data[pos++]);
+            len += b;
+        } while (b == 255);
+        return true;
+    };
+    std::size_t base = out.size();
+    std::size_t pos = 0;
+    while (pos < data.size()) {
+        unsigned char token = static_cast<unsigned char>(data[pos++]);
+        std::size_t lit = token >> 4;
+        if (lit == 15 && !read_length(pos, lit)) return false;
+        if (data.size() - pos < lit || out.size() - base + lit > limit) return false;
+        out.insert(out.end(), data.data() + pos, data.data() + pos + lit);
+        pos += lit;
+        if (pos == data.size()) break;
+        if (data.size() - pos < 2) return false;
+        std::size_t offset = static_cast<unsigned char>(data[pos])
+                | (static_cast<std::size_t>(static_cast<unsigned char>(data[pos+1])) << 8);
+        pos += 2;
+        std::size_t ml = token & 0xF;
+        if (ml == 15 && !read_length(pos, ml)) return false;
+        ml += BlockCompressor::min_match;
+        if (offset == 0 || offset > out.size() - base || out.size() - base + ml > limit) return false;
+        //match can overlap current position, so copy byte by byte
+        std::size_t from = out.size() - offset;
+        for (std::size_t i = 0; i < ml; ++i) out.push_back(out[from + i]);
+    }
+    return true;
+}
+
+template<std::invocable<std::string_view> Fn>
+inline bool BlockDecompressor::write(std::string_view data, Fn &&fn) {
+    auto iter = data.begin();
+    auto end = data.end();
+    _unprocessed = {};
+    while (iter != end) {
+        if (_header) {
+            unsigned char b = static_cast<unsigned char>(*iter++);
+            _type = b & BinaryType::mask;
+            _len_bytes = (b & BinaryType::size_mask) + 1;
+            _len = 0;
+            _header = false;
+            if (_type != BlockType::stored && _type != BlockType::compressed) {
+                _is_error = true;
+                _unprocessed = std::string_view(iter, end);
+                return false;
+            }
+        } else if (_len_bytes) {
+            _len = (_len << 8) | static_cast<unsigned char>(*iter++);
+            --_len_bytes;
+            if (_len > _max_block_size) {
+                _is_error = true;
+                _unprocessed = std::string_view(iter, end);
+                return false;
+            }
+        } else {
+            std::size_t need = _len - _block.size();
+            std::size_t avail = std::distance(iter, end);
+            std::size_t cnt = std::min(need, avail);
+            _block.insert(_block.end(), iter, iter + cnt);
+            iter += cnt;
+        }
+        if (!_header && !_len_bytes && _block.size() == _len) {
+            std::string_view out;
+            if (_type == BlockType::stored) {
+                out = std::string_view(_block.data(), _block.size());
+            } else {
+                _out.clear();
+                if (!decompress(std::string_view(_block.data(), _block.size()), _out, _max_block_size)) {
+                    _is_error = true;
+                    _unprocessed = std::string_view(iter, end);
+                    return false;
+                }
+                out = std::string_view(_out.data(), _out.size());
+            }
+            _header = true;
+            bool cont = fn(out);
+            _block.clear();
+            if (!cont) {
+                _unprocessed = std::string_view(iter, end);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+inline std::string_view CompressedSerializer::read() {
+    _block.clear();
+    while (_block.size() < _block_size) {
+        if (_pending.empty()) {
+            _pending = _ser.read();
+            if (_pending.empty()) break;
+        }
+        std::size_t cnt = std::min(_pending.size(), _block_size - _block.size());
+        _block.insert(_block.end(), _pending.begin(), _pending.begin() + cnt);
+        _pending = _pending.substr(cnt);
+    }
+    if (_block.empty()) return {};
+    return _compressor.compress(std::string_view(_block.data(), _block.size()));
+}
+
+template<ValuePreprocessor Fn>
+inline bool CompressedParser<Fn>::write(std::string_view text) {
+    if (_done) return false;
+    bool r = _decompressor.write(text, [&](std::string_view block) {
+        return _parser.write(block);
+    });
+    _done = !r;
+    return r;
+}
+
+///Serialize value into compressed binary format
+inline std::string binarize_compressed(const Value &v, SharedRefs refs = SharedRefs::none) {
+    std::string retval;
+    CompressedSerializer ser(v, refs);
+    std::string_view part = ser.read();
+    while (!part.empty()) {
+        retval.append(part);
+        part = ser.read();
+    }
+    return retval;
+}
+
+///Parse compressed binary format
+/**
+ * @param bin compressed stream
+ * @param max_block_size maximum allowed size of decompressed block
+ */
+inline Value unbinarize_compressed(std::string_view bin, std::size_t max_block_size = 1024*1024) {
+    CompressedParser<> p(max_block_size);
+    if (!p.write(bin)) {
+        if (p.is_error()) {
+            auto unproc = p.get_unprocessed_data();
+            auto at = bin.size() - unproc.size();
+            throw ParseError(at);
+        }
+        return p.get_result();
+    } else {
+        throw ParseError(bin.size());
+    }
+}
+
+}
@@ -0,0 +1,371 @@
+#pragma once
+
+#include "serializer.h"
+#include "parser.h"
+
+#include <unordered_map>
+
+namespace json {
+
+///Tags of the delta format
+/**
+ * Delta is stored in binary format. Every node of the delta is either
+ * a value in binary format (which replaces the old value) or one of following
+ * commands
+ */
+namespace DeltaType {
+    ///value is not changed
+    constexpr unsigned char keep = 0x08;
+    ///patch of an object: count of changes (arg=size of length), then pairs key + node.
+    ///Node undefined removes the key
+    constexpr unsigned char object_patch = 0x68;
+    ///patch of an array: count of commands (arg=size of length), then commands. Command
+    ///is either copy, item_patch or a value which is inserted
+    constexpr unsigned char array_patch = 0x50;
+    ///copy items from the old array: index (arg=size of length), then count as number
+    constexpr unsigned char copy = 0x58;
+    ///apply node to an item of the old array: index (arg=size of length), then the node
+    constexpr unsigned char item_patch = 0x60;
+}
+
+///Creates delta between two versions of a document
+/**
+ * The encoder walks both documents. Containers which share the same instance
+ * are skipped without inspecting their content, so the cost depends on how
+ * many containers have been changed.
+ */
+class DeltaEncoder {
+public:
+
+    ///Create delta
+    /**
+     * @param old_value previous version of the document
+     * @param new_value new version of the document
+     * @return delta in binary format. It can be applied by apply_delta()
+     */
+    std::string operator()(const Value &old_value, const Value &new_value);
+
+protected:
+    std::string _out;
+
+    void encode(const Value &old_value, const Value &new_value, std::string &out);
+    bool encode_object(const Value &old_value, const Value &new_value, std::string &out);
+    bool encode_array(const Value &old_value, const Value &new_value, std::string &out);
+    static bool unchanged(const Value &old_value, const Value &new_value);
+    static const void *container_ptr(const Value &v);
+    static void write_value(const Value &v, std::string &out);
+    static void write_copy(std::size_t index, std::size_t count, std::string &out);
+};
+
+///Applies the delta to the old version of the document
+/**
+ * The result shares all unchanged containers with the old version.
+ */
+class DeltaDecoder {
+public:
+
+    ///Apply delta
+    /**
+     * @param old_value old version of the document
+     * @param delta delta created by DeltaEncoder
+     * @return new version of the document
+     * @exception ParseError delta is corrupted or it doesn't match to the old value
+     */
+    Value operator()(const Value &old_value, std::string_view delta);
+
+protected:
+    std::string_view _data;
+    std::size_t _pos = 0;
+
+    Value read_node(const Value &old_value);
+    Value read_value();
+    std::uint64_t read_size(unsigned char tag_byte);
+    unsigned char peek();
+    [[noreturn]] void error() const;
+};
+
+///Creates delta between two versions of a document
+inline std::string make_delta(const Value &old_value, const Value &new_value) {
+    return DeltaEncoder()(old_value, new_value);
+}
+
+///Applies the delta to the old version of the document
+inline Value apply_delta(const Value &old_value, std::string_view delta) {
+    return DeltaDecoder()(old_value, delta);
+}
+
+
+inline std::string DeltaEncoder::operator()(const Value &old_value, const Value &new_value) {
+    _out.clear();
+    encode(old_value, new_value, _out);
+    return std::move(_out);
+}
+
+inline const void *DeltaEncoder::container_ptr(const Value &v) {
+    if (v.get_storage() == Storage::array) return &v.get_array();
+    else return &v.get_object();
+}
+
+inline bool DeltaEncoder::unchanged(const Value &old_value, const Value &new_value) {
+    if (old_value.is_container() || new_value.is_container()) {
+        return old_value.get_storage() == new_value.get_storage()
+                && container_ptr(old_value) == container_ptr(new_value);
+    }
+    return _details::same_content(old_value, new_value);
+}
+
+inline void DeltaEncoder::write_value(const Value &v, std::string &out) {
+    serialize_to<Format::binary>(v, out);
+}
+
+inline void DeltaEncoder::write_copy(std::size_t index, std::size_t count, std::string &out) {
+    auto iter = std::back_inserter(out);
+    iter = render_binary_type_size(DeltaType::copy, index, iter);
+    render_binary_type_size(BinaryType::p_number, count, iter);
+}
+
+inline void DeltaEncoder::encode(const Value &old_value, const Value &new_value, std::string &out) {
+    if (unchanged(old_value, new_value)) {
+        out.push_back(DeltaType::keep);
+        return;
+    }
+    auto ost = old_value.get_storage();
+    auto nst = new_value.get_storage();
+    if (ost == Storage::object && nst == Storage::object) {
+        if (encode_object(old_value, new_value, out)) return;
+    } else if (ost == Storage::array && nst == Storage::array) {
+        if (encode_array(old_value, new_value, out)) return;
+    }
+    write_value(new_value, out);
+}
+
+inline bool DeltaEncoder::encode_object(const Value &old_value, const Value &new_value, std::string &out) {
+    const auto &o = old_value.get_object();
+    const auto &n = new_value.get_object();
+    std::string body;
+    std::size_t count = 0;
+    std::size_t kept = 0;
+    auto iter1 = o.begin();
+    auto iter2 = n.begin();
+    auto write_key = [&](std::string_view key) {
+        render_binary_type_size(BinaryType::string, key.size(), std::back_inserter(body));
+        body.append(key);
+        ++count;
+    };
+    while (iter1 != o.end() || iter2 != n.end()) {
+        int c = iter1 == o.end()?1:iter2 == n.end()?-1:KeyCompare::compare(iter1->key, iter2->key);
+        if (c < 0) {
+            write_key(iter1->key);
+            body.push_back(BinaryType::undefined);
+            ++iter1;
+        } else if (c > 0) {
+            if (iter2->value.defined()) {
+                write_key(iter2->key);
+                write_value(iter2->value, body);
+            }
+            ++iter2;
+        } else {
+            if (unchanged(iter1->value, iter2->value)) {
+                ++kept;
+            } else {
+                write_key(iter2->key);
+                if (iter2->value.defined()) encode(iter1->value, iter2->value, body);
+                else body.push_back(BinaryType::undefined);
+            }
+            ++iter1;
+            ++iter2;
+        }
+    }
+    if (!kept) return false;
+    render_binary_type_size(DeltaType::object_patch, count, std::back_inserter(out));
+    out.append(body);
+    return true;
+}
+
+inline bool DeltaEncoder::encode_array(const Value &old_value, const Value &new_value, std::string &out) {
+    const auto &o = old_value.get_array();
+    const auto &n = new_value.get_array();
+    std::size_t osz = o.size();
+    std::size_t nsz = n.size();
+    std::size_t common = std::min(osz, nsz);
+    std::size_t prefix = 0;
+    while (prefix < common && unchanged(o.data()[prefix], n.data()[prefix])) ++prefix;
+    std::size_t suffix = 0;
+    while (suffix < common - prefix && unchanged(o.data()[osz - suffix - 1], n.data()[nsz - suffix - 1])) ++suffix;
+
+    std::string body;
+    std::size_t count = 0;
+    std::size_t reused = prefix + suffix;
+    std::size_t copy_from = 0;
+    std::size_t copy_count = prefix;
+    auto flush_copy = [&]{
+        if (copy_count) {
+            write_copy(copy_from, copy_count, body);
+            ++count;
+            copy_count = 0;
+        }
+    };
+    //containers of the old array, so moved items can be found by their instance
+    std::unordered_map<const void *, std::size_t> old_items;
+    for (std::size_t i = prefix; i < osz - suffix; ++i) {
+        const Value &ov = o.data()[i];
+        if (ov.is_container()) old_items.emplace(container_ptr(ov), i);
+    }
+    auto emit_copy = [&](std::size_t i) {
+        if (copy_count && copy_from + copy_count == i) {
+            ++copy_count;
+        } else {
+            flush_copy();
+            copy_from = i;
+            copy_count = 1;
+        }
+        ++reused;
+    };
+    //items in the middle are paired with old items, position is adjusted after
+    //every item found in the old array
+    std::size_t opos = prefix;
+    for (std::size_t j = prefix; j < nsz - suffix; ++j) {
+        const Value &nv = n.data()[j];
+        if (opos < osz - suffix && unchanged(o.data()[opos], nv)) {
+            emit_copy(opos++);
+            continue;
+        }
+        if (nv.is_container()) {
+            auto iter = old_items.find(container_ptr(nv));
+            if (iter != old_items.end()) {
+                emit_copy(iter->second);
+                opos = iter->second + 1;
+                continue;
+            }
+        }
+        if (opos < osz - suffix) {
+            const Value &ov = o.data()[opos];
+            if (ov.is_container() && ov.get_storage() == nv.get_storage()) {
+                flush_copy();
+                render_binary_type_size(DeltaType::item_patch, opos, std::back_inserter(body));
+                encode(ov, nv, body);
+                ++count;
+                ++reused;
+                ++opos;
+                continue;
+            }
+        }
+        flush_copy();
+        write_value(nv, body);
+        ++count;
+    }
+    flush_copy();
+    if (suffix) {
+        write_copy(osz - suffix, suffix, body);
+        ++count;
+    }
+    if (!reused) return false;
+    render_binary_type_size(DeltaType::array_patch, count, std::back_inserter(out));
+    out.append(body);
+    return true;
+}
+
+inline Value DeltaDecoder::operator()(const Value &old_value, std::string_view delta) {
+    _data = delta;
+    _pos = 0;
+    Value r = read_node(old_value);
+    if (_pos != _data.size()) error();
+    return r;
+}
+
+inline void DeltaDecoder::error() const {
+    throw ParseError(_pos);
+}
+
+inline unsigned char DeltaDecoder::peek() {
+    if (_pos >= _data.size()) error();
+    return static_cast<unsigned char>(_data[_pos]);
+}
+
+inline std::uint64_t DeltaDecoder::read_size(unsigned char tag_byte) {
+    unsigned int sz = (tag_byte & BinaryType::size_mask) + 1;
+    if (_data.size() - _pos < sz) error();
+    std::uint64_t r = 0;
+    for (unsigned int i = 0; i < sz; ++i) {
+        r = (r << 8) | static_cast<unsigned char>(_data[_pos++]);
+    }
+    return r;
+}
+
+inline Value DeltaDecoder::read_value() {
+    BinaryParser p;
+    std::string_view rest = _data.substr(_pos);
+    if (p.write(rest) || p.is_error()) error();
+    _pos += rest.size() - p.get_unprocessed_data().size();
+    return p.get_result();
+}
+
+inline Value DeltaDecoder::read_node(const Value &old_value) {
+    unsigned char b = peek();
+    if (b == DeltaType::keep) {
+        ++_pos;
+        return old_value;
+    }
+    switch (b & BinaryType::mask) {
+        case DeltaType::object_patch: {
+            //patch can't be applied to other value than object
+            if (old_value.type() != Type::object) error();
+            ++_pos;
+            auto count = read_size(b);
+            std::vector<KeyValue> changes;
+            //count comes from the input, every change takes at least one byte
+            changes.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(count, _data.size() - _pos)));
+            for (std::uint64_t i = 0; i < count; ++i) {
+                Value key = read_value();
+                if (key.type() != Type::string) error();
+                if (peek() == BinaryType::undefined) {
+                    ++_pos;
+                    changes.push_back(KeyValue(key, undefined));
+                } else {
+                    changes.push_back(KeyValue(key, read_node(old_value[key.get_string()])));
+                }
+            }
+            Value r = old_value;
+            r.merge_keys(Value(std::move(changes)));
+            return r;
+        }
+        case DeltaType::array_patch: {
+            ++_pos;
+            auto count = read_size(b);
+            const auto &arr = old_value.get_array();
+            std::vector<Value> items;
+            items.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(count, _data.size() - _pos)));
+            for (std::uint64_t i = 0; i < count; ++i) {
+                unsigned char c = peek();
+                switch (c & BinaryType::mask) {
+                    case DeltaType::copy: {
+                        ++_pos;
+                        auto index = read_size(c);
+                        unsigned char n = peek();
+                        if ((n & BinaryType::mask) != BinaryType::p_number) error();
+                        ++_pos;
+                        auto cnt = read_size(n);
+                        if (index > arr.size() || cnt > arr.size() - index) error();
+                        items.insert(items.end(), arr.begin() + index, arr.begin() + index + cnt);
+                        break;
+                    }
+                    case DeltaType::item_patch: {
+                        ++_pos;
+                        auto index = read_size(c);
+                        if (index >= arr.size()) error();
+                        items.push_back(read_node(arr.data()[index]));
+                        break;
+                    }
+                    default:
+                        items.push_back(read_value());
+                        break;
+                }
+            }
+            return Value(std::move(items));
+        }
+        default:
+            return read_value();
+    }
+}
+
+}
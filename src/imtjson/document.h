@@ -0,0 +1,145 @@
+#pragma once
+
+#include "parser.h"
+
+#include <optional>
+
+namespace json {
+
+namespace _details {
+
+inline Value escape(const Value &v, bool &copied) {
+    if (const Container<char> *str = v.get_text_container()) {
+        copied = str->in_arena();
+        return copied?Value(std::string_view(str->data(), str->size()), v.type() == Type::number):v;
+    }
+    copied = false;
+    return v.visit([&](const auto &x) -> Value {
+        using T = std::decay_t<decltype(x)>;
+        //container on the heap can still contain values from an arena
+        //builder is allocated when the first copied item is found
+        if constexpr(std::is_same_v<T, Container<Value> >) {
+            if (x.size() == 0) return v;
+            std::optional<Container<Value>::Builder> cont;
+            if (x.in_arena()) cont.emplace(Container<Value>::create_builder(x.size()));
+            for (auto iter = x.begin(); iter != x.end(); ++iter) {
+                bool c;
+                Value item = escape(*iter, c);
+                if (c && !cont) {
+                    cont.emplace(Container<Value>::create_builder(x.size()));
+                    for (auto prev = x.begin(); prev != iter; ++prev) cont->push_back(*prev);
+                }
+                if (cont) cont->push_back(std::move(item));
+            }
+            if (!cont) return v;
+            copied = true;
+            return Value(std::move(*cont));
+        } else if constexpr(std::is_same_v<T, Container<KeyValue> >) {
+            if (x.size() == 0) return v;
+            std::optional<Container<KeyValue>::Builder> cont;
+            if (x.in_arena()) cont.emplace(Container<KeyValue>::create_builder(x.size()));
+            for (auto iter = x.begin(); iter != x.end(); ++iter) {
+                bool ck, cv;
+                KeyValue kv{escape(iter->key.to_value(), ck), escape(iter->value, cv)};
+                if ((ck || cv) && !cont) {
+                    cont.emplace(Container<KeyValue>::create_builder(x.size()));
+                    for (auto prev = x.begin(); prev != iter; ++prev) cont->push_back(*prev);
+                }
+                if (cont) cont->push_back(std::move(kv));
+            }
+            if (!cont) return v;
+            copied = true;
+            check_undefined_keys(**cont);
+            return Value(std::move(*cont));
+        } else {
+            return v;
+        }
+    });
+}
+
+}
+
+///Copy value out of an arena
+/**
+ * Containers and strings allocated in an arena (see ArenaResource, Document) are
+ * copied to the global heap, including containers which reference them. Other
+ * parts of the value are shared
+ *
+ * @param v value
+ * @return value which doesn't reference any arena
+ */
+inline Value escape(const Value &v) {
+    bool copied;
+    return _details::escape(v, copied);
+}
+
+///Parsed document, which owns memory of all its values
+/**
+ * All containers and strings of the document are allocated in an arena. They
+ * are not reference counted, only the document itself is. When the last
+ * copy of the document is destroyed, the whole arena is released at once
+ * without walking the tree.
+ *
+ * Values of the document must not outlive the document. Use escape() to
+ * copy a value, which is needed longer.
+ */
+class Document {
+public:
+
+    ///Construct empty document
+    Document() = default;
+
+    ///Parse JSON text into a new document
+    /**
+     * @param text text to parse
+     * @return document
+     * @exception ParseError parse error
+     */
+    static Document parse(std::string_view text) {
+        Document doc(std::make_shared<Data>());
+        doc._data->root = json::parse(text, &doc._data->arena);
+        return doc;
+    }
+
+    ///Parse binary format into a new document
+    /**
+     * @param bin binary data
+     * @return document
+     * @exception ParseError parse error
+     */
+    static Document unbinarize(std::string_view bin) {
+        Document doc(std::make_shared<Data>());
+        doc._data->root = json::unbinarize(bin, &doc._data->arena);
+        return doc;
+    }
+
+    ///Retrieve root value
+    const Value &root() const {
+        static const Value empty;
+        return _data?_data->root:empty;
+    }
+
+    ///Access item of the root
+    template<typename X>
+    const Value &operator[](X &&x) const {return root()[std::forward<X>(x)];}
+
+    ///Copy value out of the document
+    /**
+     * @param v value of this document
+     * @return copy which doesn't reference the document
+     */
+    static Value escape(const Value &v) {return json::escape(v);}
+
+protected:
+
+    struct Data {
+        ArenaResource arena;
+        Value root;
+    };
+
+    explicit Document(std::shared_ptr<Data> data):_data(std::move(data)) {}
+
+    std::shared_ptr<Data> _data;
+};
+
+}
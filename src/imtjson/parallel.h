@@ -0,0 +1,158 @@
+#pragma once
+
+#ifdef IMTJSON_NON_ATOMIC_REFCOUNT
+#error "parallel serialization shares values between threads, it can't be used with IMTJSON_NON_ATOMIC_REFCOUNT"
+#endif
+
+#include "serializer.h"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+namespace json {
+
+namespace _details {
+
+///Serializer of a range of items of a container
+/**
+ * Renders items as they are rendered inside of the container, including
+ * separators. In text format, every item is preceded by a comma and
+ * the closing bracket is rendered at the end
+ */
+template<Format format>
+class SliceSerializer: public Serializer<format> {
+public:
+    using Super = Serializer<format>;
+
+    SliceSerializer(Value root, const Value *from, const Value *to):Super(root) {
+        this->_root_pending = false;
+        this->_stack.push_back({from, to, Super::StateType::array});
+    }
+    SliceSerializer(Value root, const KeyValue *from, const KeyValue *to):Super(root) {
+        this->_root_pending = false;
+        this->_stack.push_back({from, to, Super::StateType::object});
+    }
+};
+
+template<Format format, typename Iter>
+std::vector<std::string> serialize_slices(const Value &root, Iter begin, std::size_t count, unsigned int slices) {
+    std::vector<std::string> parts(slices);
+    std::vector<std::exception_ptr> errors(slices);
+    auto worker = [&](unsigned int idx) {
+        try {
+            Iter from = begin + (count * idx / slices);
+            Iter to = begin + (count * (idx + 1) / slices);
+            SliceSerializer<format> ser(root, from, to);
+            ser.read_all(parts[idx]);
+            if constexpr(format == Format::text) {
+                //remove closing bracket
+                parts[idx].pop_back();
+            }
+        } catch (...) {
+            errors[idx] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(slices - 1);
+    for (unsigned int i = 1; i < slices; ++i) threads.emplace_back(worker, i);
+    worker(0);
+    for (auto &t: threads) t.join();
+    for (auto &e: errors) if (e) std::rethrow_exception(e);
+    return parts;
+}
+
+}
+
+///Serialize a large container using multiple threads
+/**
+ * Items of the top-level container are split into slices, every slice is rendered
+ * by its own thread. The result is identical to the result of the Serializer
+ * (without shared references)
+ *
+ * @tparam format output format
+ * @param v value to serialize
+ * @param threads count of threads. Default value (0) uses count of hardware threads
+ * @param min_slice minimal count of items per thread. Small containers and other
+ * values are serialized by the current thread
+ * @return serialized content as ordered list of parts. Concatenation of parts
+ * is the complete output
+ */
+template<Format format = Format::text>
+std::vector<std::string> serialize_parallel(const Value &v, unsigned int threads = 0, std::size_t min_slice = 1024) {
+    if (threads == 0) threads = std::max(1U, std::thread::hardware_concurrency());
+    Type t = v.type();
+    std::size_t count = v.size();
+    threads = static_cast<unsigned int>(std::min<std::size_t>(threads, count / std::max<std::size_t>(min_slice, 1)));
+    if ((t != Type::array && t != Type::object) || threads < 2) {
+        std::vector<std::string> out(1);
+        serialize_to<format>(v, out[0]);
+        return out;
+    }
+
+    std::vector<std::string> parts;
+    if (t == Type::array) {
+        parts = _details::serialize_slices<format>(v, v.get_array().begin(), count, threads);
+    } else {
+        Value obj = v;
+        if constexpr(format == Format::text) {
+            Value tr = Serializer<format>::transform_undefined_keys(v.get_object());
+            if (tr.defined()) obj = std::move(tr);
+        }
+        count = obj.size();
+        parts = _details::serialize_slices<format>(obj, obj.get_object().begin(), count, threads);
+    }
+
+    if constexpr(format == Format::text) {
+        char open = t == Type::array?'[':'{';
+        char close = t == Type::array?']':'}';
+        //the first item doesn't have a separator, replace it by the opening bracket
+        auto iter = std::find_if(parts.begin(), parts.end(), [](const std::string &s){return !s.empty();});
+        if (iter == parts.end()) {
+            parts.clear();
+            parts.push_back({open, close});
+        } else {
+            (*iter)[0] = open;
+            parts.back().push_back(close);
+        }
+    } else {
+        std::string header;
+        render_binary_type_size(t == Type::array?BinaryType::array:BinaryType::object, count, std::back_inserter(header));
+        parts.insert(parts.begin(), std::move(header));
+    }
+    return parts;
+}
+
+///Serialize to text using multiple threads
+/**
+ * @param v value to serialize
+ * @param threads count of threads. Default value (0) uses count of hardware threads
+ * @return same output as stringify()
+ */
+inline std::string stringify_parallel(const Value &v, unsigned int threads = 0) {
+    auto parts = serialize_parallel<Format::text>(v, threads);
+    std::size_t sz = 0;
+    for (const auto &p: parts) sz += p.size();
+    std::string out = std::move(parts[0]);
+    out.reserve(sz);
+    for (std::size_t i = 1; i < parts.size(); ++i) out.append(parts[i]);
+    return out;
+}
+
+///Serialize to binary format using multiple threads
+/**
+ * @param v value to serialize
+ * @param threads count of threads. Default value (0) uses count of hardware threads
+ * @return same output as binarize()
+ */
+inline std::string binarize_parallel(const Value &v, unsigned int threads = 0) {
+    auto parts = serialize_parallel<Format::binary>(v, threads);
+    std::size_t sz = 0;
+    for (const auto &p: parts) sz += p.size();
+    std::string out;
+    out.reserve(sz);
+    for (const auto &p: parts) out.append(p);
+    return out;
+}
+
+}
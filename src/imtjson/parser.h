@@ -80,6 +80,19 @@ public:
      */
     std::string_view get_unprocessed_data() const;
 
+    ///Reset the parser to parse next value
+    /**
+     * Allocated buffers are reused
+     */
+    void reset();
+
+    ///Set memory resource used to allocate containers and long strings
+    /**
+     * @param resource memory resource. The resource must outlive all parsed values.
+     * Set nullptr to use the global heap (default)
+     */
+    void set_memory_resource(std::pmr::memory_resource *resource) {_resource = resource;}
+
 protected:
 
     //Reading new value, detect type
@@ -133,16 +146,21 @@ protected:
     struct StateBinArray {
         std::size_t sz = 0;
         std::vector<Value> data;
+        bool indefinite = false;
+        std::size_t ref_id = 0;
     };
     struct StateBinObject {
         bool _reading_key = false;
         Key key;
         std::vector<KeyValue> data;
         std::size_t sz = 0;
+        bool indefinite = false;
+        std::size_t ref_id = 0;
     };
+    struct StateBinRef {};
 
     using StateText = std::variant<DetectType, StateCheck, StateString, StateNumber, StateArray, StateObject>;
-    using StateBin =  std::variant<DetectType, StateDoubleNumber, StateBinNumber, StateBinString, StateBinArray, StateBinObject>;
+    using StateBin =  std::variant<DetectType, StateDoubleNumber, StateBinNumber, StateBinString, StateBinArray, StateBinObject, StateBinRef>;
     using State = std::conditional_t<format == Format::text, StateText, StateBin>;
 
     Fn _preproc;
@@ -154,7 +172,14 @@ protected:
     bool do_parse_cycle();
 
     Value _result;
+    std::pmr::memory_resource *_resource = nullptr;
     bool _is_error = false;
+    //terminator of indefinite container has been read
+    bool _container_end = false;
+    //stream started by BinaryType::shared_refs, containers are tracked
+    bool _track_refs = false;
+    //containers which can be referenced by BinaryType::reference (indexed by id)
+    std::vector<Value> _shared;
 
     bool parse_state(DetectType &);
     bool parse_state(StateString &st);
@@ -167,6 +192,7 @@ protected:
     bool parse_state(StateBinString &st);
     bool parse_state(StateBinArray &st);
     bool parse_state(StateBinObject &st);
+    bool parse_state(StateBinRef &st);
     bool finish_state(DetectType &, const Value &v);
     bool finish_state(StateString &st, const Value &v);
     bool finish_state(StateArray &st, const Value &v);
@@ -178,8 +204,10 @@ protected:
     bool finish_state(StateBinString &st, const Value &v);
     bool finish_state(StateBinArray &st, const Value &v);
     bool finish_state(StateBinObject &st, const Value &v);
+    bool finish_state(StateBinRef &st, const Value &v);
 
     Value adjustObject(Value v);
+    bool can_close_container() const;
 
 
 };
@@ -211,7 +239,7 @@ inline bool is_valid_json_number(Iter beg, Iter end) {
         }
     }
 
-    if (std::equal(beg,end,infinity.begin())) {
+    if (std::equal(beg,end,infinity.begin(),infinity.end())) {
         return true;
     }
 
@@ -295,6 +323,17 @@ inline std::string_view Parser<Fn, format>::get_unprocessed_data() const {
     return std::string_view(_pos, std::distance(_pos, _end));
 }
 
+template<ValuePreprocessor Fn, Format format>
+inline void Parser<Fn, format>::reset() {
+    _state.clear();
+    _state.push_back(DetectType());
+    _result = Value();
+    _is_error = false;
+    _container_end = false;
+    _track_refs = false;
+    _shared.clear();
+}
+
 template<ValuePreprocessor Fn, Format format>
 inline bool Parser<Fn, format>::do_parse_cycle() {
     if (_state.empty()) return false;
@@ -368,6 +407,22 @@ inline bool Parser<Fn, format>::parse_state(DetectType&) {
                     case BinaryType::double_number:
                         _state.push_back(StateDoubleNumber());
                         break;
+                    case BinaryType::indefinite_array:
+                        _state.push_back(StateBinArray{0, {}, true});
+                        _state.push_back(DetectType());
+                        break;
+                    case BinaryType::indefinite_object:
+                        _state.push_back(StateBinObject{true, {}, {}, 0, true});
+                        _state.push_back(DetectType());
+                        break;
+                    case BinaryType::container_end:
+                        if (!can_close_container()) {
+                            _is_error = true;
+                            return false;
+                        }
+                        _container_end = true;
+                        _result = Value();
+                        return false;
                     default: _result = _preproc(Value());return false;
                 }
                 break;
@@ -394,6 +449,18 @@ inline bool Parser<Fn, format>::parse_state(DetectType&) {
                 _state.push_back(StateBinObject());
                 _state.push_back(StateBinNumber{sz, false});
                 break;
+            case BinaryType::reference:
+                _state.push_back(StateBinRef());
+                _state.push_back(StateBinNumber{sz, false});
+                break;
+            case BinaryType::shared_refs:
+                //allowed only before the root value
+                if (type != BinaryType::shared_refs || _state.size() != 1 || _track_refs) {
+                    _is_error = true;
+                    return false;
+                }
+                _track_refs = true;
+                return true;
             default:
                 _is_error = true;
                 return false;
@@ -502,7 +569,7 @@ inline bool Parser<Fn, format>::parse_state(StateString &st) {
                 ++_pos;
                 auto end = decode_json_string(st._data.begin(), st._data.end(), st._data.begin());
                 st._data.resize(std::distance(st._data.begin(), end));
-                _result = Value(st._data);
+                _result = Value(st._data, false, _resource);
                 return false;
             } else if (*_pos == '\\') {
                 st._escape = true;
@@ -529,7 +596,7 @@ inline bool Parser<Fn, format>::parse_state(StateArray &st) {
                         }
                 break;
                 case ']': ++_pos;
-                          _result = Value(std::move(st._data));
+                          _result = Value(std::move(st._data), _resource);
                           return false;
                 default: if (st._data.empty()) {
                             _state.push_back(DetectType{});
@@ -567,7 +634,7 @@ inline bool Parser<Fn, format>::parse_state(StateObject &st) {
 
                 case '}':   if (st._reading_key) {
                                 ++_pos;
-                                _result = adjustObject(std::move(st._data));
+                                _result = adjustObject(Value(std::move(st._data), _resource));
                                 return false;
                             }
                 break;
@@ -614,9 +681,11 @@ inline bool Parser<Fn, format>::parse_state(StateNumber &st) {
             ++_pos;
         } else {
             if (is_valid_json_number(st._data.begin(), st._data.end())) {
-                _result = Value(st._data, true);
-                return false;
+                _result = Value(st._data, true, _resource);
+            } else {
+                _is_error = true;
             }
+            return false;
         }
     }
     return true;
@@ -710,7 +779,7 @@ inline bool Parser<Fn, format>::parse_state(StateBinString &st) {
     while (_pos != _end) {
         st.data.push_back(*_pos++);
         if (st.data.size() >= st.sz) {
-            _result = Value(st.data, st.is_number);
+            _result = Value(st.data, st.is_number, _resource);
             return false;
         }
     }
@@ -719,14 +788,32 @@ inline bool Parser<Fn, format>::parse_state(StateBinString &st) {
 
 template<ValuePreprocessor Fn, Format format>
 inline bool Parser<Fn, format>::parse_state(StateBinArray &st) {
-    _result = Value(st.data);
+    _result = Value(st.data, _resource);
     return false;
 
 }
 
 template<ValuePreprocessor Fn, Format format>
 inline bool Parser<Fn, format>::parse_state(StateBinObject &st) {
-    _result = Value(st.data);
+    _result = Value(st.data, _resource);
+    return false;
+}
+
+template<ValuePreprocessor Fn, Format format>
+inline bool Parser<Fn, format>::parse_state(StateBinRef &) {
+    _is_error = true;
+    return false;
+}
+
+template<ValuePreprocessor Fn, Format format>
+inline bool Parser<Fn, format>::finish_state(StateBinRef &, const Value &v) {
+    std::size_t id = v.get();
+    //reference can point only to already finished container
+    if (id >= _shared.size() || !_shared[id].defined()) {
+        _is_error = true;
+        return false;
+    }
+    _result = _shared[id];
     return false;
 }
 
@@ -758,8 +845,33 @@ inline bool Parser<Fn, format>::finish_state(StateBinString &st, const Value &v)
     return true;
 }
 
+template<ValuePreprocessor Fn, Format format>
+inline bool Parser<Fn, format>::can_close_container() const {
+    if (_state.size() < 2) return false;
+    return std::visit([](const auto &st) {
+        using T = std::decay_t<decltype(st)>;
+        if constexpr(std::is_same_v<T, StateBinArray>) {
+            return st.indefinite;
+        } else if constexpr(std::is_same_v<T, StateBinObject>) {
+            return st.indefinite && st._reading_key;
+        } else {
+            return false;
+        }
+    }, _state[_state.size()-2]);
+}
+
 template<ValuePreprocessor Fn, Format format>
 inline bool Parser<Fn, format>::finish_state(StateBinArray &st, const Value &v) {
+    if (st.indefinite) {
+        if (_container_end) {
+            _container_end = false;
+            _result = Value(std::move(st.data), _resource);
+            return false;
+        }
+        st.data.push_back(v);
+        _state.push_back(DetectType());
+        return true;
+    }
     if (st.sz == 0) {
         st.sz = v.get();
         if (st.sz == 0) {
@@ -767,6 +879,10 @@ inline bool Parser<Fn, format>::finish_state(StateBinArray &st, const Value &v)
             return false;
         }
         st.data.reserve(st.sz);
+        if (_track_refs) {
+            st.ref_id = _shared.size();
+            _shared.emplace_back();
+        }
         _state.push_back(DetectType());
         return true;
     } else {
@@ -775,7 +891,8 @@ inline bool Parser<Fn, format>::finish_state(StateBinArray &st, const Value &v)
             _state.push_back(DetectType());
             return true;
         } else {
-            _result = std::move(st.data);
+            _result = Value(std::move(st.data), _resource);
+            if (_track_refs) _shared[st.ref_id] = _result;
             return false;
         }
     }
@@ -783,6 +900,26 @@ inline bool Parser<Fn, format>::finish_state(StateBinArray &st, const Value &v)
 
 template<ValuePreprocessor Fn, Format format>
 inline bool Parser<Fn, format>::finish_state(StateBinObject &st, const Value &v) {
+    if (st.indefinite) {
+        if (_container_end) {
+            _container_end = false;
+            _result = Value(std::move(st.data), _resource);
+            return false;
+        }
+        if (st._reading_key) {
+            if (v.type() != Type::string) {
+                _is_error = true;
+                return false;
+            }
+            st.key = v;
+            st._reading_key = false;
+        } else {
+            st.data.push_back(KeyValue{st.key,v});
+            st._reading_key = true;
+        }
+        _state.push_back(DetectType());
+        return true;
+    }
     if (st.sz == 0) {
         st.sz = v.get();
         if (st.sz == 0) {
@@ -791,6 +928,10 @@ inline bool Parser<Fn, format>::finish_state(StateBinObject &st, const Value &v)
         }
         st.data.reserve(st.sz);
         st._reading_key = true;
+        if (_track_refs) {
+            st.ref_id = _shared.size();
+            _shared.emplace_back();
+        }
         _state.push_back(DetectType());
         return true;
     } else if (st._reading_key){
@@ -809,14 +950,24 @@ inline bool Parser<Fn, format>::finish_state(StateBinObject &st, const Value &v)
             _state.push_back(DetectType());
             return true;
         } else {
-            _result = std::move(st.data);
+            _result = Value(std::move(st.data), _resource);
+            if (_track_refs) _shared[st.ref_id] = _result;
             return false;
         }
     }
 }
 
-inline Value parse(std::string_view text) {
+///Parse JSON text
+/**
+ * @param text text to parse
+ * @param resource memory resource used to allocate containers and long strings,
+ * nullptr - global heap
+ * @return parsed value
+ * @exception ParseError parse error
+ */
+inline Value parse(std::string_view text, std::pmr::memory_resource *resource = nullptr) {
     Parser p;
+    p.set_memory_resource(resource);
     if (!p.write(text)) {
         if (p.is_error()) {
             auto unproc = p.get_unprocessed_data();
@@ -831,8 +982,9 @@ inline Value parse(std::string_view text) {
 }
 
 
-inline Value unbinarize(std::string_view bin) {
+inline Value unbinarize(std::string_view bin, std::pmr::memory_resource *resource = nullptr) {
     BinaryParser p;
+    p.set_memory_resource(resource);
     if (!p.write(bin)) {
         if (p.is_error()) {
             auto unproc = p.get_unprocessed_data();
@@ -849,9 +1001,10 @@ inline Value unbinarize(std::string_view bin) {
 
 template<ValuePreprocessor Fn, Format format>
 inline Value json::Parser<Fn, format>::adjustObject(Value v) {
-    const Value &del = v[undef_key_name];
+    //binary search, operator[] would build hash index of large objects
+    const Value &del = _details::find_key(v.get_object(), Key(undef_key_name));
     if (del.defined()) {
-        auto cont = Container<KeyValue>::create_builder(v.size()+del.size());
+        auto cont = Container<KeyValue>::create_builder(v.size()+del.size(), _resource);
         for (const Value &x: del) {
             cont.push_back(KeyValue(x, undefined));
         }
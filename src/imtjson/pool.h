@@ -0,0 +1,257 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <new>
+
+namespace json {
+
+///Statistics of the PoolResource
+struct PoolStats {
+    ///allocations served from a free list
+    std::size_t hits = 0;
+    ///allocations served by the global heap
+    std::size_t misses = 0;
+    ///blocks released by other thread than the thread which allocated them
+    std::size_t remote_frees = 0;
+};
+
+///Memory resource with per-thread free lists of small blocks
+/**
+ * Small blocks are grouped to size classes. Every thread has its own free list for
+ * each size class, so allocation and release on the same thread doesn't need
+ * any synchronization. Blocks released by other thread are returned to
+ * the owning thread through a lock-free stack. When a thread exits, its free blocks
+ * are released and the blocks which are still in use are released directly to
+ * the global heap later.
+ *
+ * Large blocks are allocated from the global heap directly.
+ *
+ * Use PoolResource::instance() as a memory resource of the parser or the Value
+ * constructors.
+ */
+class PoolResource: public std::pmr::memory_resource {
+public:
+
+    ///Size classes
+    static constexpr std::size_t class_sizes[] = {64, 96, 128, 192, 256, 384, 512, 768, 1024};
+    static constexpr unsigned int class_count = sizeof(class_sizes)/sizeof(class_sizes[0]);
+    ///Maximum count of free blocks in a free list of a thread
+    static constexpr std::size_t max_free_blocks = 1024;
+
+    ///Retrieve the pool
+    static PoolResource &instance() {
+        //never destroyed, blocks can be released during static destruction
+        static PoolResource *inst = new PoolResource;
+        return *inst;
+    }
+
+    ///Retrieve statistics
+    /**
+     * @return statistics of all threads. Counters of running threads (except
+     * the current thread) are updated periodically, so they can be slightly behind
+     */
+    PoolStats stats() const;
+
+protected:
+
+    PoolResource() = default;
+
+    static constexpr std::size_t header_size = 16;
+    static constexpr std::size_t flush_interval = 256;
+
+    struct ThreadCache;
+
+    struct alignas(16) Header {
+        ThreadCache *owner;
+        unsigned int cls;
+    };
+
+    struct FreeNode {
+        FreeNode *next;
+    };
+
+    struct ThreadCache {
+        FreeNode *free[class_count] = {};
+        std::size_t free_count[class_count] = {};
+        //count of blocks allocated by this thread and not yet released
+        std::size_t live = 0;
+        //blocks released by other threads
+        std::atomic<FreeNode *> remote = nullptr;
+        //outstanding blocks of an exited thread
+        std::atomic<std::size_t> orphan_live = 0;
+        PoolStats stats;
+        std::size_t ops = 0;
+    };
+
+    //marks the remote stack of an exited thread
+    static FreeNode *orphan_mark() {
+        static FreeNode mark;
+        return &mark;
+    }
+
+    struct ThreadHolder {
+        ThreadCache *cache = nullptr;
+        ~ThreadHolder() {
+            ThreadCache *c = cache;
+            cache = nullptr;
+            if (c) PoolResource::instance().orphan(c);
+        }
+    };
+
+    std::atomic<std::size_t> _hits = 0;
+    std::atomic<std::size_t> _misses = 0;
+    std::atomic<std::size_t> _remote_frees = 0;
+
+    static ThreadCache *&current() {
+        static thread_local ThreadHolder holder;
+        return holder.cache;
+    }
+
+    static unsigned int class_of(std::size_t bytes) {
+        unsigned int cls = 0;
+        while (class_sizes[cls] < bytes) ++cls;
+        return cls;
+    }
+
+    static Header *header(FreeNode *node) {
+        return reinterpret_cast<Header *>(node);
+    }
+
+    static void free_block(void *hdr, unsigned int cls) {
+        ::operator delete(hdr, class_sizes[cls] + header_size);
+    }
+
+    void flush_stats(ThreadCache *c) {
+        _hits.fetch_add(c->stats.hits, std::memory_order_relaxed);
+        _misses.fetch_add(c->stats.misses, std::memory_order_relaxed);
+        _remote_frees.fetch_add(c->stats.remote_frees, std::memory_order_relaxed);
+        c->stats = {};
+        c->ops = 0;
+    }
+
+    void release_local(ThreadCache *c, FreeNode *node, unsigned int cls);
+    void drain_remote(ThreadCache *c);
+    void orphan(ThreadCache *c);
+
+    virtual void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+    virtual void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override;
+    virtual bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+inline void PoolResource::release_local(ThreadCache *c, FreeNode *node, unsigned int cls) {
+    --c->live;
+    if (c->free_count[cls] >= max_free_blocks) {
+        free_block(node, cls);
+    } else {
+        node->next = c->free[cls];
+        c->free[cls] = node;
+        ++c->free_count[cls];
+    }
+}
+
+inline void PoolResource::drain_remote(ThreadCache *c) {
+    FreeNode *node = c->remote.exchange(nullptr, std::memory_order_acquire);
+    while (node) {
+        FreeNode *next = node->next;
+        release_local(c, node, header(node)->cls);
+        node = next;
+    }
+}
+
+inline void *PoolResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    if (bytes > class_sizes[class_count-1] || alignment > header_size) {
+        return ::operator new(bytes, std::align_val_t(alignment));
+    }
+    ThreadCache *&c = current();
+    if (!c) c = new ThreadCache;
+    unsigned int cls = class_of(bytes);
+    if (!c->free[cls] && c->remote.load(std::memory_order_relaxed)) drain_remote(c);
+    FreeNode *node = c->free[cls];
+    if (node) {
+        c->free[cls] = node->next;
+        --c->free_count[cls];
+        ++c->stats.hits;
+    } else {
+        node = static_cast<FreeNode *>(::operator new(class_sizes[cls] + header_size));
+        ++c->stats.misses;
+    }
+    if (++c->ops >= flush_interval) flush_stats(c);
+    ++c->live;
+    Header *h = header(node);
+    h->owner = c;
+    h->cls = cls;
+    return reinterpret_cast<char *>(node) + header_size;
+}
+
+inline void PoolResource::do_deallocate(void *p, std::size_t bytes, std::size_t alignment) {
+    if (bytes > class_sizes[class_count-1] || alignment > header_size) {
+        ::operator delete(p, bytes, std::align_val_t(alignment));
+        return;
+    }
+    FreeNode *node = reinterpret_cast<FreeNode *>(static_cast<char *>(p) - header_size);
+    ThreadCache *owner = header(node)->owner;
+    unsigned int cls = header(node)->cls;
+    ThreadCache *c = current();
+    if (owner == c) {
+        release_local(c, node, cls);
+        return;
+    }
+    if (c) ++c->stats.remote_frees;
+    else _remote_frees.fetch_add(1, std::memory_order_relaxed);
+    FreeNode *head = owner->remote.load(std::memory_order_acquire);
+    do {
+        if (head == orphan_mark()) {
+            //owner has exited
+            free_block(node, cls);
+            if (owner->orphan_live.fetch_sub(1, std::memory_order_acq_rel) == 1) delete owner;
+            return;
+        }
+        //the link overwrites the owner, the class is kept in the header
+        node->next = head;
+    } while (!owner->remote.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_acquire));
+}
+
+inline void PoolResource::orphan(ThreadCache *c) {
+    constexpr std::size_t bias = std::numeric_limits<std::size_t>::max() / 2;
+    c->orphan_live.store(bias, std::memory_order_relaxed);
+    FreeNode *node = c->remote.exchange(orphan_mark(), std::memory_order_acq_rel);
+    while (node) {
+        FreeNode *next = node->next;
+        --c->live;
+        free_block(node, header(node)->cls);
+        node = next;
+    }
+    for (unsigned int i = 0; i < class_count; ++i) {
+        FreeNode *f = c->free[i];
+        while (f) {
+            FreeNode *next = f->next;
+            free_block(f, i);
+            f = next;
+        }
+    }
+    flush_stats(c);
+    //remaining blocks release the cache
+    std::size_t sub = bias - c->live;
+    if (c->orphan_live.fetch_sub(sub, std::memory_order_acq_rel) == sub) delete c;
+}
+
+inline PoolStats PoolResource::stats() const {
+    PoolStats out;
+    out.hits = _hits.load(std::memory_order_relaxed);
+    out.misses = _misses.load(std::memory_order_relaxed);
+    out.remote_frees = _remote_frees.load(std::memory_order_relaxed);
+    if (ThreadCache *c = current()) {
+        out.hits += c->stats.hits;
+        out.misses += c->stats.misses;
+        out.remote_frees += c->stats.remote_frees;
+    }
+    return out;
+}
+
+}
@@ -2,11 +2,26 @@
 #include "value.h"
 #include "common.h"
 
-#include <variant>
 #include <type_traits>
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <cmath>
+#include <cstring>
+#include <charconv>
+#include <bit>
+#include <span>
+#include <memory>
+#include <optional>
+#include <atomic>
+#include <system_error>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if __has_include(<unistd.h>)
+#include <unistd.h>
+#include <cerrno>
+#endif
 
 
 namespace json {
@@ -17,11 +32,156 @@ concept NumberType = std::is_arithmetic_v<T>;
 template<typename T>
 concept IntegralType = std::is_integral_v<T>;
 
+namespace _details {
+
+inline bool need_escape(char c) {
+    return static_cast<unsigned char>(c) < 0x20 || c == '"' || c == '\\';
+}
+
+///Find first character which needs to be escaped
+/**
+ * @param p begin of text
+ * @param end end of text
+ * @return pointer to the character, or end if there is no such character
+ */
+inline const char *find_escape(const char *p, const char *end) {
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i ctl = _mm_set1_epi8(0x1F);
+    while (end - p >= 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, backslash));
+        //unsigned x <= 0x1F
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_min_epu8(x, ctl), x));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(m));
+        if (mask) return p + std::countr_zero(mask);
+        p += 16;
+    }
+#else
+    constexpr std::uint64_t ones = 0x0101010101010101ULL;
+    constexpr std::uint64_t high = 0x8080808080808080ULL;
+    auto has_zero = [](std::uint64_t v) {return (v - ones) & ~v & high;};
+    while (end - p >= 8) {
+        std::uint64_t w;
+        std::memcpy(&w, p, sizeof(w));
+        //bytes less than 0x20, quotes or backslashes, exact position is found below
+        if (((w - ones * 0x20) & ~w & high) | has_zero(w ^ (ones * '"')) | has_zero(w ^ (ones * '\\'))) break;
+        p += 8;
+    }
+#endif
+    while (p != end && !need_escape(*p)) ++p;
+    return p;
+}
+
+}
+
+///Cache of serialized containers
+/**
+ * When the cache is used by the serializer, serialized content of each container
+ * with enough items is attached to the container. Next serialization of the same
+ * container (even as part of other document) emits the stored content as is.
+ * Stored content is released together with the container.
+ *
+ * The object is a handle, copies share the same cache. It is thread safe.
+ */
+class SerializerCache {
+public:
+
+    ///Construct cache
+    /**
+     * @param max_bytes maximum total size of cached content
+     * @param min_items minimum count of items of the container to be cached
+     */
+    SerializerCache(std::size_t max_bytes, std::size_t min_items = 8)
+        :_ctl(std::make_shared<Control>(max_bytes, min_items)) {}
+
+    ///Count of containers found in the cache
+    std::size_t hits() const {return _ctl->hits.load(std::memory_order_relaxed);}
+    ///Count of containers not found in the cache
+    std::size_t misses() const {return _ctl->misses.load(std::memory_order_relaxed);}
+    ///Total size of cached content
+    std::size_t used() const {return _ctl->used.load(std::memory_order_relaxed);}
+
+    ///Find cached content
+    /**
+     * @param cont container
+     * @param format format
+     * @return pointer to cached content, or nullptr if not cached
+     */
+    template<typename T>
+    const std::string *find(const Container<T> &cont, Format format) const;
+
+    ///Store content
+    /**
+     * @param cont container
+     * @param format format
+     * @param content serialized content. When the limit has been reached, the
+     * content is left in this variable
+     * @return pointer to stored content. Returns nullptr, when the limit has been reached
+     */
+    template<typename T>
+    const std::string *store(const Container<T> &cont, Format format, std::string &&content) const;
+
+    ///Determines, whether the container should be cached
+    template<typename T>
+    bool is_candidate(const Container<T> &cont) const {
+        //attachments of containers in an arena would not be released
+        return cont.size() >= _ctl->min_items && !cont.in_arena()
+                && _ctl->used.load(std::memory_order_relaxed) < _ctl->max_bytes;
+    }
+
+protected:
+
+    struct Control {
+        std::size_t max_bytes;
+        std::size_t min_items;
+        std::atomic<std::size_t> used = 0;
+        std::atomic<std::size_t> hits = 0;
+        std::atomic<std::size_t> misses = 0;
+        //addresses of these members are used as id of attachments
+        char text_id = 0;
+        char binary_id = 0;
+
+        Control(std::size_t max_bytes, std::size_t min_items)
+            :max_bytes(max_bytes),min_items(min_items) {}
+        const void *id(Format format) const {return format == Format::text?&text_id:&binary_id;}
+    };
+
+    class Entry: public ContainerAttachment {
+    public:
+        Entry(std::shared_ptr<Control> ctl, Format format, std::string content)
+            :ContainerAttachment(ctl->id(format)),_ctl(std::move(ctl)),_content(std::move(content)) {}
+        ~Entry() {_ctl->used.fetch_sub(_content.size(), std::memory_order_relaxed);}
+        const std::string &content() const {return _content;}
+    protected:
+        std::shared_ptr<Control> _ctl;
+        std::string _content;
+    };
+
+    std::shared_ptr<Control> _ctl;
+};
+
 template<Format format = Format::text>
 class Serializer {
 public:
 
-    Serializer(Value v):_stack({v}) {}
+    ///Default size of chunk returned by read()
+    static constexpr std::size_t default_chunk_size = 16384;
+    ///Minimal size of string, which is referenced in place by read_segments()
+    static constexpr std::size_t min_segment_size = 256;
+
+    ///Construct serializer
+    /**
+     * @param v value to serialize
+     * @param refs (binary only) specifies, whether repeated containers are
+     * written as references to the first occurrence. The parser then
+     * reconstructs them as shared instances.
+     * @param chunk_size preferred size of chunk returned by read(). Chunk can be
+     * slightly larger, because the last value is always rendered whole
+     */
+    Serializer(Value v, SharedRefs refs = SharedRefs::none, std::size_t chunk_size = default_chunk_size)
+        :_root(v),_shared_refs(refs),_chunk_size(chunk_size) {}
 
     ///Read serialized content
     /**
@@ -31,35 +191,119 @@ public:
      */
     std::string_view read();
 
+    ///Render rest of the content directly to the string
+    /**
+     * @param out string, content is appended
+     */
+    void read_all(std::string &out);
+
+    ///Read serialized content as list of segments
+    /**
+     * Works as read(), but large strings (which don't need escaping) and cached
+     * containers are not copied, they are referenced in place. Other content is
+     * rendered to the internal buffer. The result can be sent by writev()
+     * without copying
+     *
+     * @return list of segments. If empty list is returned, everything is serialized.
+     * The list and buffered segments are valid until next read. Segments
+     * referencing the source value are valid during lifetime of the serializer
+     * (the serializer holds the source value)
+     */
+    std::span<const std::string_view> read_segments();
+
+    ///Use cache of serialized containers
+    /**
+     * @param cache cache. The cache is not used in binary format with shared
+     * references
+     */
+    void set_cache(SerializerCache cache) {_cache.emplace(std::move(cache));}
+
 
-    template<typename Fn>
+    template<std::invocable<char> Fn>
     static void encode(std::string_view text, Fn fn);
 
+    ///Encode text as content of JSON string
+    /**
+     * @param text text to encode
+     * @param out output, content is appended
+     * @retval true text doesn't need escaping (it was copied as is)
+     * @retval false some characters have been escaped
+     */
+    static bool encode(std::string_view text, std::string &out);
+
+    ///Transform object with undefined values to the form used by the text format
+    /**
+     * Undefined values are removed, their keys are listed under the undef_key_name.
+     * Keys with this prefix are escaped by repeating the prefix
+     *
+     * @param v object
+     * @return transformed object, or undefined when no transformation is needed
+     */
+    static Value transform_undefined_keys(const Container<KeyValue> &v);
+
 public:
 
 
 
 protected:
 
-    struct StateArray {
-        Value::Iterator pos;
-        Value::Iterator end;
+    enum class StateType: unsigned char {
+        array,
+        object,
+        ///object which is owned by the top of _tmp_values
+        object_tmp
     };
-    struct StateObject {
-        Value::KeyValueIterator pos;
-        Value::KeyValueIterator end;
-        Value _tmp;
+    ///Position in an opened container (pos and end point either to Value or KeyValue)
+    struct State {
+        const void *pos;
+        const void *end;
+        StateType type;
     };
-    using State = std::variant<Value, StateObject, StateArray>;
 
 
-    std::vector<char> _out_buff;
+    Value _root;
+    std::string _out_buff;
     std::vector<State> _stack;
+    //temporary objects referenced by the stack
+    std::vector<Value> _tmp_values;
+    //root value is not rendered yet
+    bool _root_pending = true;
     std::map<const AbstractCustomValue *, Value> _custom_values;
+    SharedRefs _shared_refs;
+    std::size_t _chunk_size;
+    std::unordered_map<const void *, std::size_t> _ref_ids;
+    std::size_t _next_ref_id = 0;
+    std::unordered_map<const void *, std::size_t> _content_hashes;
+    struct ContentRef {
+        const void *ptr;
+        std::size_t id;
+        bool object;
+    };
+    std::unordered_multimap<std::size_t, ContentRef> _content_refs;
+    std::optional<SerializerCache> _cache;
+    //container which is being rendered to the cache
+    const void *_cache_skip = nullptr;
+    //segment which is either part of _out_buff (ptr == nullptr) or external data
+    struct SegmentRef {
+        const char *ptr;
+        std::size_t offset;
+        std::size_t size;
+    };
+    //true when read_segments() is active
+    bool _gather = false;
+    std::vector<SegmentRef> _seg_refs;
+    std::vector<std::string_view> _segments;
+    std::size_t _seg_mark = 0;
+    std::size_t _external_size = 0;
+
+    void append_external(std::string_view data);
 
     void next();
+    bool finished() const {return !_root_pending && _stack.empty();}
     void render_value(const Value &v);
     void render_key(const Key &v);
+    void render_long_string(const Container<char> &v);
+    bool render_cached(const Value &v);
 
     void render_item(const Container<Value> &v, Type );
     void render_item(const Container<KeyValue> &v, Type );
@@ -74,81 +318,177 @@ protected:
 
     void render_binary_type_size(unsigned char type, std::uint64_t size);
     void render_object(const Container<KeyValue> &v, Value &&tmp);
+
+    template<typename T>
+    bool render_shared(const Container<T> &v);
+    std::size_t content_hash(const Value &v);
+    template<typename T>
+    std::size_t content_hash(const Container<T> &v);
 };
 
 
 template<Format format>
 inline std::string_view Serializer<format>::read() {
     _out_buff.clear();
-    next();
-    return std::string_view(_out_buff.data(),_out_buff.size());
+    while (!finished() && _out_buff.size() < _chunk_size) next();
+    return _out_buff;
+}
+
+template<Format format>
+inline void Serializer<format>::read_all(std::string &out) {
+    std::swap(out, _out_buff);
+    while (!finished()) next();
+    std::swap(out, _out_buff);
+    _out_buff.clear();
 }
 
 template<Format format>
 inline void Serializer<format>::next() {
-    if (_stack.empty()) return;
-    auto &st = _stack.back();
-    if (std::holds_alternative<Value>(st)) {
-        Value v = std::get<Value>(st);
-        _stack.pop_back();
-        render_value(v);
-    } else if (std::holds_alternative<StateObject>(st)) {
-        StateObject &s = std::get<StateObject>(st);
-        if (s.pos == s.end) {
+    if (_root_pending) {
+        _root_pending = false;
+        if constexpr(format == Format::binary) {
+            //parser tracks containers only when the stream can contain references
+            if (_shared_refs != SharedRefs::none) _out_buff.push_back(static_cast<char>(BinaryType::shared_refs));
+        }
+        render_value(_root);
+        return;
+    }
+    while (!_stack.empty()) {
+        State &st = _stack.back();
+        if (st.pos == st.end) {
             if constexpr(format == Format::text) {
-                _out_buff.push_back('}');
+                _out_buff.push_back(st.type == StateType::array?']':'}');
             }
+            if (st.type == StateType::object_tmp) _tmp_values.pop_back();
             _stack.pop_back();
-            next();
-        } else {
-            const KeyValue &kv = *s.pos;
-            ++s.pos;
+        } else if (st.type == StateType::array) {
+            const Value *v = static_cast<const Value *>(st.pos);
+            st.pos = v + 1;
             if constexpr(format == Format::text) {
-                if (!kv.value.defined()) {
-                    next();
-                    return;
-                }
+                if (!v->defined()) continue;
                 _out_buff.push_back(',');
             }
-            render_key(kv.key);
-            if constexpr(format == Format::text) {
-                _out_buff.push_back(':');
-            }
-            render_value(kv.value);
-        }
-    } else {
-        StateArray &s = std::get<StateArray>(st);
-        if (s.pos == s.end) {
-            if constexpr(format == Format::text) {
-                _out_buff.push_back(']');
-            }
-            _stack.pop_back();
-            next();
+            render_value(*v);
+            return;
         } else {
-            const Value &v = *s.pos;
-            ++s.pos;
+            const KeyValue *kv = static_cast<const KeyValue *>(st.pos);
+            st.pos = kv + 1;
             if constexpr(format == Format::text) {
-                if (!v.defined()) {
-                    next();
-                    return;
-                }
+                if (!kv->value.defined()) continue;
                 _out_buff.push_back(',');
             }
-            render_value(v);
+            render_key(kv->key);
+            if constexpr(format == Format::text) {
+                _out_buff.push_back(':');
+            }
+            render_value(kv->value);
+            return;
         }
     }
 }
 
 template<Format format>
 inline void Serializer<format>::render_value(const Value &v) {
+    if (_cache && v.is_container() && render_cached(v)) return;
+    if (const Container<char> *str = v.get_string_container()) {
+        render_long_string(*str);
+        return;
+    }
     v.visit([&](const auto &item){
         render_item(item, v.type());
     });
 }
 
+template<Format format>
+inline bool Serializer<format>::render_cached(const Value &v) {
+    if (format == Format::binary && _shared_refs != SharedRefs::none) return false;
+    return v.visit([&](const auto &cont) {
+        using T = std::decay_t<decltype(cont)>;
+        if constexpr(std::is_same_v<T, Container<Value> > || std::is_same_v<T, Container<KeyValue> >) {
+            if (&cont == _cache_skip || !_cache->is_candidate(cont)) return false;
+            const std::string *content = _cache->find(cont, format);
+            if (!content) {
+                Serializer<format> sub(v);
+                sub.set_cache(*_cache);
+                sub._cache_skip = &cont;
+                std::string out;
+                sub.read_all(out);
+                content = _cache->store(cont, format, std::move(out));
+                if (!content) {
+                    //limit reached, content has been moved back
+                    _out_buff.append(out);
+                    return true;
+                }
+            }
+            append_external(*content);
+            return true;
+        } else {
+            return false;
+        }
+    });
+}
+
 template<Format format>
 inline void Serializer<format>::render_key(const Key &v) {
-    render_item(v.get_string(),Type::string);
+    render_value(v.to_value());
+}
+
+template<Format format>
+inline void Serializer<format>::render_long_string(const Container<char> &v) {
+    std::string_view text(v.data(), v.size());
+    bool large = _gather && text.size() >= min_segment_size;
+    if constexpr(format == Format::text) {
+        _out_buff.push_back('"');
+        bool clean = v.test_flag(ContainerFlag::clean_text);
+        if (!clean && large) {
+            const char *end = text.data() + text.size();
+            clean = _details::find_escape(text.data(), end) == end;
+            if (clean) v.set_flag(ContainerFlag::clean_text);
+        }
+        if (clean) {
+            if (large) append_external(text); else _out_buff.append(text);
+        } else if (encode(text, _out_buff)) {
+            v.set_flag(ContainerFlag::clean_text);
+        }
+        _out_buff.push_back('"');
+    } else {
+        render_binary_type_size(BinaryType::string, text.size());
+        if (large) append_external(text); else _out_buff.append(text);
+    }
+}
+
+template<Format format>
+inline void Serializer<format>::append_external(std::string_view data) {
+    if (!_gather) {
+        _out_buff.append(data);
+        return;
+    }
+    if (_out_buff.size() > _seg_mark) {
+        _seg_refs.push_back({nullptr, _seg_mark, _out_buff.size() - _seg_mark});
+        _seg_mark = _out_buff.size();
+    }
+    _seg_refs.push_back({data.data(), 0, data.size()});
+    _external_size += data.size();
+}
+
+template<Format format>
+inline std::span<const std::string_view> Serializer<format>::read_segments() {
+    _out_buff.clear();
+    _seg_refs.clear();
+    _segments.clear();
+    _seg_mark = 0;
+    _external_size = 0;
+    _gather = true;
+    while (!finished() && _out_buff.size() + _external_size < _chunk_size) next();
+    _gather = false;
+    if (_out_buff.size() > _seg_mark) {
+        _seg_refs.push_back({nullptr, _seg_mark, _out_buff.size() - _seg_mark});
+    }
+    for (const SegmentRef &s: _seg_refs) {
+        _segments.push_back(s.ptr?std::string_view(s.ptr, s.size)
+                                 :std::string_view(_out_buff.data() + s.offset, s.size));
+    }
+    return _segments;
 }
 
 template<Format format>
@@ -156,6 +496,7 @@ inline void Serializer<format>::render_item(const Container<Value> &v, Type ) {
     if constexpr(format == Format::text) {
         _out_buff.push_back('[');
     } else {
+        if (render_shared(v)) return;
         render_binary_type_size(BinaryType::array, v.size());
     }
     auto pos = v.begin();
@@ -164,7 +505,7 @@ inline void Serializer<format>::render_item(const Container<Value> &v, Type ) {
         const Value &v = *pos;
         ++pos;
         if (format == Format::binary || v.defined()) {
-            _stack.push_back(StateArray{pos, end});
+            _stack.push_back(State{pos, end, StateType::array});
             render_value(v);
             return;
         }
@@ -175,38 +516,39 @@ inline void Serializer<format>::render_item(const Container<Value> &v, Type ) {
 }
 
 template<Format format>
-inline void Serializer<format>::render_item(const Container<KeyValue> &v, Type ) {
-    if constexpr(format == Format::text) {
-        //detect undefined keys
-        std::vector<Value> undef_keys;
-        bool need_transform = false;
-        for (const KeyValue &x: v) {
-            if (!x.value.defined()) {
-                undef_keys.push_back(x.key.to_value());
-                need_transform = true;
-            } else if (static_cast<std::string_view>(x.key) == undef_key_name) {
-                need_transform = true;
+inline Value Serializer<format>::transform_undefined_keys(const Container<KeyValue> &v) {
+    //the flag is usually computed when the object is constructed
+    if (!check_undefined_keys(v)) return {};
+    std::vector<Value> undef_keys;
+    for (const KeyValue &x: v) {
+        if (!x.value.defined()) undef_keys.push_back(x.key.to_value());
+    }
+    auto cont = Container<KeyValue>::create_builder(v.size()+1);
+    cont.push_back(KeyValue(undef_key_name, undef_keys));
+    std::string buffer;
+    for (const KeyValue &x: v) {
+        if (x.value.defined()) {
+            std::string_view keyname = x.key;
+            if (keyname.compare(0,undef_key_name.size(), undef_key_name) == 0) {
+                buffer.clear();
+                buffer.append(undef_key_name);
+                buffer.append(keyname);
+                cont.push_back(KeyValue(buffer, x.value));
+            } else {
+                cont.push_back(x);
             }
         }
-        if (need_transform) {
-            auto cont = Container<KeyValue>::create_builder(v.size()+1);
-            cont.push_back(KeyValue(undef_key_name, undef_keys));
-            std::string buffer;
-            for (const KeyValue &x: v) {
-                if (x.value.defined()) {
-                    std::string_view keyname = x.key;
-                    if (keyname.compare(0,undef_key_name.size(), undef_key_name) == 0) {
-                        buffer.clear();
-                        buffer.append(undef_key_name);
-                        buffer.append(keyname);
-                        cont.push_back(KeyValue(buffer, x.value));
-                    } else {
-                        cont.push_back(x);
-                    }
-                }
-            }
-            const auto &ref = *cont;
-            render_object(ref, Value(std::move(cont)));
+    }
+    return Value(std::move(cont));
+}
+
+template<Format format>
+inline void Serializer<format>::render_item(const Container<KeyValue> &v, Type ) {
+    if constexpr(format == Format::text) {
+        Value tr = transform_undefined_keys(v);
+        if (tr.defined()) {
+            const auto &ref = tr.get_object();
+            render_object(ref, std::move(tr));
             return;
         }
     }
@@ -217,6 +559,7 @@ inline void Serializer<format>::render_object(const Container<KeyValue> &v, Valu
     if constexpr(format == Format::text) {
         _out_buff.push_back('{');
     } else {
+        if (render_shared(v)) return;
         render_binary_type_size(BinaryType::object, v.size());
     }
     auto pos = v.begin();
@@ -228,7 +571,12 @@ inline void Serializer<format>::render_object(const Container<KeyValue> &v, Valu
         if constexpr(format == Format::text) {
             _out_buff.push_back(':');
         }
-        _stack.push_back(StateObject{pos, end, std::move(tmp)});
+        if (tmp.defined()) {
+            _tmp_values.push_back(std::move(tmp));
+            _stack.push_back(State{pos, end, StateType::object_tmp});
+        } else {
+            _stack.push_back(State{pos, end, StateType::object});
+        }
         render_value(kv.value);
         return;
     }
@@ -254,7 +602,7 @@ inline void Serializer<format>::render_item(std::string_view v, Type type) {
             std::copy(v.begin(), v.end(), std::back_inserter(_out_buff));
         } else {
             _out_buff.push_back('"');
-            encode(v, [&](char c){_out_buff.push_back(c);});
+            encode(v, _out_buff);
             _out_buff.push_back('"');
         }
     } else {
@@ -293,23 +641,62 @@ Iter render_unsigned_number2(T val, Iter out) {
 }
 
 
+namespace _details {
+
+constexpr char digit_pairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+constexpr std::uint64_t powers_of_10[] = {
+        1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+        100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+        10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+        100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+///Count of decimal digits of the number (at least 1)
+constexpr unsigned int count_digits(std::uint64_t val) {
+    //log10(2) ~ 1233/4096, approximation is corrected by the table
+    unsigned int t = (static_cast<unsigned int>(std::bit_width(val | 1)) * 1233) >> 12;
+    return t + 1 - ((val | 1) < powers_of_10[t]);
+}
+
+}
+
+///Render unsigned number as decimal text
+/**
+ * @param val value
+ * @param out output iterator
+ * @return output iterator after the last digit
+ */
 template<typename T, typename Iter>
 Iter render_unsigned_number(T val, Iter out) {
-    if (!val) {
-        *out++ = '0';
-        return out;
+    std::uint64_t v = val;
+    char buff[20];
+    unsigned int len = _details::count_digits(v);
+    char *p = buff + len;
+    while (v >= 100) {
+        unsigned int idx = static_cast<unsigned int>(v % 100) * 2;
+        v /= 100;
+        *--p = _details::digit_pairs[idx+1];
+        *--p = _details::digit_pairs[idx];
+    }
+    if (v >= 10) {
+        unsigned int idx = static_cast<unsigned int>(v) * 2;
+        *--p = _details::digit_pairs[idx+1];
+        *--p = _details::digit_pairs[idx];
     } else {
-        char buff[sizeof(T)*3];
-        auto itr = std::rbegin(buff);
-        while (val != 0) {
-            unsigned int dig = static_cast<unsigned int>(val%10);
-            val = val / 10;
-            *itr++ = dig+'0';
-        }
-        auto chrs = std::distance(std::rbegin(buff), itr);
-        return std::copy(std::end(buff)-chrs, std::end(buff), out);
+        *--p = static_cast<char>('0' + v);
     }
-
+    return std::copy(buff, buff + len, out);
 }
 
 
@@ -320,18 +707,20 @@ inline void json::Serializer<format>::render_item(const T &v, Type t) {
         if constexpr(!std::is_unsigned_v<T>) {
             if (v < 0) {
                 _out_buff.push_back('-');
-                render_item(static_cast<std::make_unsigned_t<T> >(-v), t);
+                using U = std::make_unsigned_t<T>;
+                render_item(static_cast<U>(U(0) - static_cast<U>(v)), t);
                 return;
             }
         }
-        render_unsigned_number(v, std::back_inserter(_out_buff));
+        char buff[20];
+        _out_buff.append(buff, render_unsigned_number(v, buff));
     } else {
         unsigned char type;
         std::uint64_t val;
         if constexpr(!std::is_unsigned_v<T>) {
             if (v < 0) {
                 type = BinaryType::n_number;
-                val = static_cast<std::uint64_t>(-v);
+                val = std::uint64_t(0) - static_cast<std::uint64_t>(v);
             } else {
                 type = BinaryType::p_number;
                 val = static_cast<std::uint64_t>(v);
@@ -368,40 +757,14 @@ inline void Serializer<format>::render_item(double v, Type ) {
             _out_buff.push_back('"');
             return;
         }
-
-        if (v < 0) {
-            _out_buff.push_back('-');
-            v = -v;
-        }
-        if (v < std::numeric_limits<double>::min()) {
+        if (v == 0) {
             _out_buff.push_back('0');
             return;
         }
-        double exp_f = std::log10(v);
-        int exponent = static_cast<int>(std::floor(exp_f));
-        if (exponent < -2 || exponent>8) {
-            v = v / std::pow(10, exponent);
-        } else {
-            exponent = 0;
-        }
-        double ip;
-        double fr = std::modf(v+std::numeric_limits<double>::epsilon(), &ip);
-        render_item(static_cast<unsigned long>(ip), Type::number);
-        if (fr > 1e-6) {
-            _out_buff.push_back('.');
-            for (int i = 0; i < 12 && fr > 1e-6; i++) {
-                fr = std::modf(fr * 10, &ip);
-                unsigned int n = static_cast<unsigned int>(ip)+'0';
-                _out_buff.push_back(static_cast<char>(n));
-            }
-        }
-        if (exponent) {
-            _out_buff.push_back('e');
-            if (exponent > 0) {
-                _out_buff.push_back('+');
-            }
-            render_item(exponent, Type::number);
-        }
+        //shortest representation which is parsed back to the same value
+        char buff[32];
+        auto res = std::to_chars(std::begin(buff), std::end(buff), v);
+        _out_buff.append(std::begin(buff), res.ptr);
     } else {
         _out_buff.push_back(BinaryType::double_number);
         std::string_view data (reinterpret_cast<const char *>(&v), sizeof(v));
@@ -411,16 +774,16 @@ inline void Serializer<format>::render_item(double v, Type ) {
 }
 
 template<Format format>
-template<typename Fn>
+template<std::invocable<char> Fn>
 inline void Serializer<format>::encode(std::string_view text, Fn fn) {
     for (char c : text) {
           switch (c) {
               case '"':fn('\\');fn('"');break;
               case '\\':fn('\\');fn('\\');break;
-              case '\b':fn('b');fn('\\');break;
+              case '\b':fn('\\');fn('b');break;
               case '\f':fn('\\');fn('f');break;
               case '\n':fn('\\');fn('n');break;
-              case '\r':fn('\\');fn('f');break;
+              case '\r':fn('\\');fn('r');break;
               case '\t':fn('\\');fn('t');break;
               default:
                   if (c>= 0 && c < 0x20) {
@@ -435,46 +798,587 @@ inline void Serializer<format>::encode(std::string_view text, Fn fn) {
     }
 }
 
+template<Format format>
+inline bool Serializer<format>::encode(std::string_view text, std::string &out) {
+    const char *p = text.data();
+    const char *end = p + text.size();
+    bool clean = true;
+    while (p != end) {
+        const char *q = _details::find_escape(p, end);
+        out.append(p, q);
+        if (q == end) break;
+        clean = false;
+        encode(std::string_view(q, 1), [&](char c){out.push_back(c);});
+        p = q + 1;
+    }
+    return clean;
+}
 
-inline std::string stringify(const Value &v) {
-    std::string retval;
-    Serializer ser(v);
+
+using BinarySerializer = Serializer<Format::binary>;
+
+///Serialize value to a sink
+/**
+ * @tparam format output format
+ * @param v value to serialize
+ * @param sink function called for every chunk of serialized content
+ * @param chunk_size preferred size of chunk
+ */
+template<Format format = Format::text, std::invocable<std::string_view> Sink>
+inline void serialize_to(const Value &v, Sink &&sink, std::size_t chunk_size = Serializer<format>::default_chunk_size) {
+    Serializer<format> ser(v, SharedRefs::none, chunk_size);
     std::string_view part = ser.read();
     while (!part.empty()) {
-        retval.append(part);
+        sink(part);
         part = ser.read();
     }
+}
+
+///Serialize value to a string
+/**
+ * @tparam format output format
+ * @param v value to serialize
+ * @param out output string, content is appended. The serializer renders directly
+ * to the string
+ */
+template<Format format = Format::text>
+inline void serialize_to(const Value &v, std::string &out) {
+    Serializer<format> ser(v);
+    ser.read_all(out);
+}
+
+///Serialize value to a fixed buffer
+/**
+ * @tparam format output format
+ * @param v value to serialize
+ * @param buffer output buffer
+ * @return size of whole serialized content. If the returned value is larger than
+ * size of the buffer, the output has been truncated
+ */
+template<Format format = Format::text>
+inline std::size_t serialize_to(const Value &v, std::span<char> buffer) {
+    std::size_t total = 0;
+    serialize_to<format>(v, [&](std::string_view part) {
+        if (total < buffer.size()) {
+            std::size_t cnt = std::min(part.size(), buffer.size() - total);
+            std::copy(part.begin(), part.begin() + cnt, buffer.begin() + total);
+        }
+        total += part.size();
+    });
+    return total;
+}
+
+#if __has_include(<unistd.h>)
+///Sink which writes to a file descriptor
+/**
+ * @code
+ * serialize_to(v, FileDescriptorSink{fd});
+ * @endcode
+ *
+ * @exception std::system_error write failed
+ */
+struct FileDescriptorSink {
+    int fd;
+    void operator()(std::string_view data) const {
+        while (!data.empty()) {
+            auto r = ::write(fd, data.data(), data.size());
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::generic_category());
+            }
+            data = data.substr(static_cast<std::size_t>(r));
+        }
+    }
+};
+#endif
+
+inline std::string stringify(const Value &v) {
+    std::string retval;
+    serialize_to(v, retval);
     return retval;
 }
 
-using BinarySerializer = Serializer<Format::binary>;
+///Serialize value to a string using the cache of serialized containers
+inline std::string stringify(const Value &v, const SerializerCache &cache) {
+    std::string retval;
+    Serializer ser(v);
+    ser.set_cache(cache);
+    ser.read_all(retval);
+    return retval;
+}
 
-inline std::string binarize(const Value &v) {
+///Serialize value into binary format
+/**
+ * @param v value to serialize
+ * @param refs specifies whether shared containers are written as references
+ * @return binary representation
+ */
+inline std::string binarize(const Value &v, SharedRefs refs = SharedRefs::none) {
+    std::string retval;
+    BinarySerializer ser(v, refs);
+    ser.read_all(retval);
+    return retval;
+}
+
+///Serialize value into binary format using the cache of serialized containers
+inline std::string binarize(const Value &v, const SerializerCache &cache) {
     std::string retval;
     BinarySerializer ser(v);
-    std::string_view part = ser.read();
-    while (!part.empty()) {
-        retval.append(part);
-        part = ser.read();
-    }
+    ser.set_cache(cache);
+    ser.read_all(retval);
     return retval;
 }
 
+namespace _details {
 
+///Calculates exact size of serialized value
 template<Format format>
-inline void json::Serializer<format>::render_binary_type_size(unsigned char type, std::uint64_t size) {
-    unsigned char count_bytes = 0;
-    auto tmp = size;
-    for (unsigned int i = 0; i < 8; ++i) {
-        count_bytes += bool(tmp > 0);
-        tmp>>=8;
-    }
-    count_bytes = std::max<unsigned char>(1, count_bytes);
-    _out_buff.push_back(type | (count_bytes-1));
+class SizeCounter {
+public:
+
+    explicit SizeCounter(bool cache_sizes):_cache_sizes(cache_sizes) {}
+
+    std::size_t operator()(const Value &v) const;
+
+    ///Size of the header of binary type (type + size bytes)
+    static constexpr std::size_t binary_header(std::uint64_t size) {
+        return 1 + (static_cast<std::size_t>(std::bit_width(size | 1)) + 7) / 8;
+    }
+
+    ///Size of encoded string including quotes
+    static std::size_t text_string(std::string_view text);
+
+    ///Minimal count of items of the container to store its size as an attachment
+    static constexpr std::size_t min_cached_items = 8;
+
+protected:
+    bool _cache_sizes;
+
+    class Attachment: public ContainerAttachment {
+    public:
+        static constexpr char id = format == Format::text?'t':'b';
+        Attachment(std::size_t size):ContainerAttachment(&id),size(size) {}
+        const std::size_t size;
+    };
+
+    template<typename T>
+    std::size_t container(const Container<T> &cont) const;
+    std::size_t content(const Container<Value> &cont) const;
+    std::size_t content(const Container<KeyValue> &cont) const;
+    std::size_t item(const Value &v) const;
+};
+
+template<Format format>
+inline std::size_t SizeCounter<format>::text_string(std::string_view text) {
+    std::size_t sz = text.size() + 2;
+    const char *p = text.data();
+    const char *end = p + text.size();
+    while ((p = find_escape(p, end)) != end) {
+        switch (*p) {
+            case '"': case '\\': case '\b': case '\f':
+            case '\n': case '\r': case '\t': sz += 1; break;
+            default: sz += 5; break;
+        }
+        ++p;
+    }
+    return sz;
+}
+
+template<Format format>
+inline std::size_t SizeCounter<format>::operator()(const Value &v) const {
+    if constexpr(format == Format::text) {
+        if (!v.defined()) return null_value.size();
+    }
+    return item(v);
+}
+
+template<Format format>
+inline std::size_t SizeCounter<format>::item(const Value &v) const {
+    if (const Container<char> *str = v.get_string_container()) {
+        std::string_view text(str->data(), str->size());
+        if constexpr(format == Format::text) {
+            if (str->test_flag(ContainerFlag::clean_text)) return text.size() + 2;
+            std::size_t sz = text_string(text);
+            if (sz == text.size() + 2) str->set_flag(ContainerFlag::clean_text);
+            return sz;
+        } else {
+            return binary_header(text.size()) + text.size();
+        }
+    }
+    return v.visit([&](const auto &x) -> std::size_t {
+        using T = std::decay_t<decltype(x)>;
+        if constexpr(std::is_same_v<T, Container<Value> > || std::is_same_v<T, Container<KeyValue> >) {
+            return container(x);
+        } else if constexpr(std::is_same_v<T, bool>) {
+            if constexpr(format == Format::text) return x?true_value.size():false_value.size();
+            else return 1;
+        } else if constexpr(std::is_same_v<T, std::nullptr_t>) {
+            if constexpr(format == Format::text) return null_value.size();
+            else return 1;
+        } else if constexpr(std::is_same_v<T, Undefined>) {
+            if constexpr(format == Format::text) return null_value.size();
+            else return 1;
+        } else if constexpr(std::is_same_v<T, double>) {
+            if constexpr(format == Format::text) {
+                if (std::isnan(x)) return null_value.size();
+                if (!std::isfinite(x)) return (x < 0?neg_infinity.size():infinity.size()) + 2;
+                if (x == 0) return 1;
+                char buff[32];
+                return static_cast<std::size_t>(std::to_chars(std::begin(buff), std::end(buff), x).ptr - buff);
+            } else {
+                return 1 + sizeof(double);
+            }
+        } else if constexpr(std::is_integral_v<T>) {
+            std::uint64_t mag;
+            bool neg = false;
+            if constexpr(std::is_signed_v<T>) {
+                using U = std::make_unsigned_t<T>;
+                neg = x < 0;
+                mag = neg?static_cast<U>(U(0) - static_cast<U>(x)):static_cast<U>(x);
+            } else {
+                mag = x;
+            }
+            if constexpr(format == Format::text) return count_digits(mag) + neg;
+            else return binary_header(mag);
+        } else if constexpr(std::is_same_v<T, std::string_view>) {
+            if constexpr(format == Format::text) {
+                return v.type() == Type::number?x.size():text_string(x);
+            } else {
+                return binary_header(x.size()) + x.size();
+            }
+        } else {
+            //custom value
+            return item(x.to_json());
+        }
+    });
+}
+
+template<Format format>
+template<typename T>
+inline std::size_t SizeCounter<format>::container(const Container<T> &cont) const {
+    bool cache = _cache_sizes && cont.size() >= min_cached_items && !cont.in_arena();
+    if (cache) {
+        if (auto att = cont.find_attachment(&Attachment::id)) {
+            return static_cast<const Attachment *>(att)->size;
+        }
+    }
+    std::size_t sz = content(cont);
+    if (cache) cont.attach(std::make_unique<Attachment>(sz));
+    return sz;
+}
+
+template<Format format>
+inline std::size_t SizeCounter<format>::content(const Container<Value> &cont) const {
+    if constexpr(format == Format::text) {
+        std::size_t sz = 1;
+        for (const Value &v: cont) {
+            if (v.defined()) sz += item(v) + 1;
+        }
+        return std::max<std::size_t>(sz, 2);
+    } else {
+        std::size_t sz = binary_header(cont.size());
+        for (const Value &v: cont) sz += item(v);
+        return sz;
+    }
+}
+
+template<Format format>
+inline std::size_t SizeCounter<format>::content(const Container<KeyValue> &cont) const {
+    if constexpr(format == Format::text) {
+        Value tr = Serializer<format>::transform_undefined_keys(cont);
+        const Container<KeyValue> &obj = tr.defined()?tr.get_object():cont;
+        std::size_t sz = 1;
+        for (const KeyValue &kv: obj) {
+            sz += item(kv.key.to_value()) + item(kv.value) + 2;
+        }
+        return std::max<std::size_t>(sz, 2);
+    } else {
+        std::size_t sz = binary_header(cont.size());
+        for (const KeyValue &kv: cont) {
+            sz += item(kv.key.to_value()) + item(kv.value);
+        }
+        return sz;
+    }
+}
+
+}
+
+///Calculate exact size of serialized value
+/**
+ * The calculation doesn't render the output, so it can be used to allocate
+ * the output buffer in advance. Shared references are not considered
+ *
+ * @tparam format format of the output
+ * @param v value
+ * @param cache_sizes store calculated sizes of large containers as attachments
+ * of the containers. Repeated calculation over the same containers is then
+ * immediate
+ * @return size of output in bytes
+ */
+template<Format format = Format::text>
+inline std::size_t serialized_size(const Value &v, bool cache_sizes = false) {
+    return _details::SizeCounter<format>(cache_sizes)(v);
+}
+
+template<typename T>
+inline const std::string *SerializerCache::find(const Container<T> &cont, Format format) const {
+    auto att = cont.find_attachment(_ctl->id(format));
+    if (att) {
+        _ctl->hits.fetch_add(1, std::memory_order_relaxed);
+        return &static_cast<const Entry *>(att)->content();
+    }
+    _ctl->misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+template<typename T>
+inline const std::string *SerializerCache::store(const Container<T> &cont, Format format, std::string &&content) const {
+    std::size_t sz = content.size();
+    if (_ctl->used.fetch_add(sz, std::memory_order_relaxed) + sz > _ctl->max_bytes) {
+        _ctl->used.fetch_sub(sz, std::memory_order_relaxed);
+        return nullptr;
+    }
+    auto att = cont.attach(std::make_unique<Entry>(_ctl, format, std::move(content)));
+    return &static_cast<const Entry *>(att)->content();
+}
+
+///Generates binary format incrementally
+/**
+ * Containers are opened with indefinite length and closed by a terminator,
+ * so the producer doesn't need to know count of items in advance. Result
+ * can be parsed by the BinaryParser
+ *
+ * @code
+ * BinaryStreamWriter wr;
+ * wr.begin_array();
+ * while (has_more()) {
+ *     wr.write(next_item());
+ *     send(wr.read());
+ * }
+ * wr.end();
+ * send(wr.read());
+ * @endcode
+ *
+ * @note the writer doesn't validate structure, caller is responsible to
+ * close every opened container and to write a key before every value of the object
+ */
+class BinaryStreamWriter {
+public:
+    ///Open array of unknown length
+    void begin_array();
+    ///Open object of unknown length
+    /** Items are written as key() followed by a value */
+    void begin_object();
+    ///Write key of next item of the object
+    void key(std::string_view k);
+    ///Write complete value
+    void write(const Value &v);
+    ///Close recently opened container
+    void end();
+    ///Write already encoded content
+    void write_raw(std::string_view data);
+    ///Read generated content
+    /**
+     * @return content generated since last read. Returned string is valid
+     * until next call of the read()
+     */
+    std::string_view read();
+
+protected:
+    std::vector<char> _out_buff;
+    std::vector<char> _read_buff;
+};
+
+
+template<typename Iter>
+Iter render_binary_type_size(unsigned char type, std::uint64_t size, Iter out) {
+    unsigned char count_bytes = static_cast<unsigned char>((std::bit_width(size | 1) + 7) / 8);
+    *out++ = type | (count_bytes-1);
     while (count_bytes > 0) {
         --count_bytes;
-        _out_buff.push_back((size >> (count_bytes * 8)) & 0xFF);
+        *out++ = (size >> (count_bytes * 8)) & 0xFF;
+    }
+    return out;
+}
+
+template<Format format>
+inline void json::Serializer<format>::render_binary_type_size(unsigned char type, std::uint64_t size) {
+    json::render_binary_type_size(type, size, std::back_inserter(_out_buff));
+}
+
+namespace _details {
+
+inline std::size_t hash_combine(std::size_t a, std::size_t b) {
+    return a ^ (b + 0x9e3779b9 + (a << 6) + (a >> 2));
+}
+
+template<typename T>
+inline std::pair<bool, std::uint64_t> sign_magnitude(T v) {
+    if constexpr(std::is_signed_v<T>) {
+        if (v < 0) return {true, static_cast<std::uint64_t>(-static_cast<std::int64_t>(v))};
+    }
+    return {false, static_cast<std::uint64_t>(v)};
+}
+
+template<typename T>
+bool same_content(const Container<T> &a, const Container<T> &b);
+
+///Determines whether values have the same content and the same binary representation
+inline bool same_content(const Value &a, const Value &b) {
+    return a.visit([&](const auto &x) {
+        return b.visit([&](const auto &y) {
+            using A = std::decay_t<decltype(x)>;
+            using B = std::decay_t<decltype(y)>;
+            if constexpr(std::is_same_v<A, B>) {
+                if constexpr(std::is_same_v<A, std::string_view>) {
+                    return a.type() == b.type() && x == y;
+                } else if constexpr(std::is_same_v<A, double>) {
+                    return std::memcmp(&x, &y, sizeof(double)) == 0;
+                } else if constexpr(std::is_same_v<A, Container<Value> > || std::is_same_v<A, Container<KeyValue> >) {
+                    return same_content(x, y);
+                } else if constexpr(std::is_same_v<A, AbstractCustomValue>) {
+                    return &x == &y;
+                } else {
+                    return x == y;
+                }
+            } else if constexpr(std::is_integral_v<A> && std::is_integral_v<B>
+                    && !std::is_same_v<A, bool> && !std::is_same_v<B, bool>) {
+                return _details::sign_magnitude(x) == _details::sign_magnitude(y);
+            } else {
+                return false;
+            }
+        });
+    });
+}
+
+template<typename T>
+inline bool same_content(const Container<T> &a, const Container<T> &b) {
+    if (&a == &b) return true;
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if constexpr(std::is_same_v<T, KeyValue>) {
+            if (a.data()[i].key.get_string() != b.data()[i].key.get_string()
+                || !same_content(a.data()[i].value, b.data()[i].value)) return false;
+        } else {
+            if (!same_content(a.data()[i], b.data()[i])) return false;
+        }
     }
+    return true;
+}
+
+}
+
+template<Format format>
+template<typename T>
+inline bool Serializer<format>::render_shared(const Container<T> &v) {
+    if (_shared_refs == SharedRefs::none || v.size() == 0) return false;
+    auto iter = _ref_ids.find(&v);
+    if (iter != _ref_ids.end()) {
+        render_binary_type_size(BinaryType::reference, iter->second);
+        return true;
+    }
+    if (_shared_refs == SharedRefs::same_content) {
+        constexpr bool is_object = std::is_same_v<T, KeyValue>;
+        std::size_t h = content_hash(v);
+        auto rng = _content_refs.equal_range(h);
+        for (auto it = rng.first; it != rng.second; ++it) {
+            const ContentRef &ref = it->second;
+            if (ref.object == is_object && _details::same_content(*static_cast<const Container<T> *>(ref.ptr), v)) {
+                _ref_ids.emplace(&v, ref.id);
+                render_binary_type_size(BinaryType::reference, ref.id);
+                return true;
+            }
+        }
+        _content_refs.emplace(h, ContentRef{&v, _next_ref_id, is_object});
+    }
+    _ref_ids.emplace(&v, _next_ref_id++);
+    return false;
+}
+
+template<Format format>
+inline std::size_t Serializer<format>::content_hash(const Value &v) {
+    return v.visit([&](const auto &item) -> std::size_t {
+        using T = std::decay_t<decltype(item)>;
+        if constexpr(std::is_same_v<T, Container<Value> > || std::is_same_v<T, Container<KeyValue> >) {
+            return content_hash(item);
+        } else if constexpr(std::is_same_v<T, std::string_view>) {
+            return _details::hash_combine(std::hash<std::string_view>()(item), static_cast<std::size_t>(v.type()));
+        } else if constexpr(std::is_same_v<T, double>) {
+            std::uint64_t bits;
+            std::memcpy(&bits, &item, sizeof(bits));
+            return std::hash<std::uint64_t>()(bits);
+        } else if constexpr(std::is_same_v<T, bool>) {
+            return item?1:2;
+        } else if constexpr(std::is_integral_v<T>) {
+            auto [neg, mag] = _details::sign_magnitude(item);
+            return _details::hash_combine(std::hash<std::uint64_t>()(mag), neg);
+        } else if constexpr(std::is_same_v<T, AbstractCustomValue>) {
+            return std::hash<const void *>()(&item);
+        } else {
+            return static_cast<std::size_t>(v.type());
+        }
+    });
+}
+
+template<Format format>
+template<typename T>
+inline std::size_t Serializer<format>::content_hash(const Container<T> &v) {
+    std::size_t h = std::is_same_v<T, KeyValue>?0x38:0x30;
+    if (v.size() == 0) return h;
+    auto iter = _content_hashes.find(&v);
+    if (iter != _content_hashes.end()) return iter->second;
+    for (const T &x: v) {
+        if constexpr(std::is_same_v<T, KeyValue>) {
+            h = _details::hash_combine(h, std::hash<std::string_view>()(x.key.get_string()));
+            h = _details::hash_combine(h, content_hash(x.value));
+        } else {
+            h = _details::hash_combine(h, content_hash(x));
+        }
+    }
+    _content_hashes.emplace(&v, h);
+    return h;
+}
+
+inline void BinaryStreamWriter::begin_array() {
+    _out_buff.push_back(BinaryType::indefinite_array);
+}
+
+inline void BinaryStreamWriter::begin_object() {
+    _out_buff.push_back(BinaryType::indefinite_object);
+}
+
+inline void BinaryStreamWriter::key(std::string_view k) {
+    render_binary_type_size(BinaryType::string, k.size(), std::back_inserter(_out_buff));
+    _out_buff.insert(_out_buff.end(), k.begin(), k.end());
+}
+
+inline void BinaryStreamWriter::write(const Value &v) {
+    //strings and simple values don't need the serializer
+    if (v.get_storage() != Storage::custom_type) {
+        switch (v.type()) {
+            case Type::null: _out_buff.push_back(BinaryType::null); return;
+            case Type::boolean: _out_buff.push_back(v.get_bool()?BinaryType::bool_true:BinaryType::bool_false); return;
+            case Type::string: key(v.get_string()); return;
+            default: break;
+        }
+    }
+    serialize_to<Format::binary>(v, [&](std::string_view part) {
+        _out_buff.insert(_out_buff.end(), part.begin(), part.end());
+    });
+}
+
+inline void BinaryStreamWriter::end() {
+    _out_buff.push_back(BinaryType::container_end);
+}
+
+inline void BinaryStreamWriter::write_raw(std::string_view data) {
+    _out_buff.insert(_out_buff.end(), data.begin(), data.end());
+}
+
+inline std::string_view BinaryStreamWriter::read() {
+    std::swap(_out_buff, _read_buff);
+    _out_buff.clear();
+    return std::string_view(_read_buff.data(), _read_buff.size());
 }
 
 }
@@ -0,0 +1,572 @@
+#pragma once
+
+#include "serializer.h"
+#include "parser.h"
+
+namespace json {
+
+///Converts JSON text to the binary format without building the document
+/**
+ * The transcoder reads text in chunks and generates binary format in chunks. Only
+ * the structure is tracked, scalar values are parsed by the Parser and written
+ * immediately. Arrays and objects are written as containers of indefinite length.
+ *
+ * @code
+ * TextToBinary tc;
+ * bool need_more = true;
+ * while (need_more) {
+ *      need_more = tc.write(receive());
+ *      send(tc.read());
+ * }
+ * if (tc.is_error()) ... //handle error
+ * @endcode
+ *
+ * With keep_order, memory usage is limited by size of the largest scalar value. If
+ * the source order of keys is not kept, objects must be sorted. Content of every
+ * object (including nested containers) is transcoded to the binary format
+ * and buffered until the object is closed, then its items are written
+ * sorted. Memory usage is then limited by binary size of the largest
+ * top-level object, no document is built. Arrays outside of objects are streamed
+ */
+class TextToBinary {
+public:
+
+    ///Construct transcoder
+    /**
+     * @param keep_order if true, keys of objects are written in the source order
+     * without buffering. The BinaryParser sorts keys when the object is
+     * constructed. If false, objects are sorted and the first of duplicate keys is kept.
+     *
+     * @note Keys are written as they appear in the text. Unlike parse(), the transcoder
+     * doesn't convert the undef_key_name entry to undefined values, and when the text
+     * contains duplicate keys, parse() keeps any of them. For other texts, the output
+     * contains the same objects as binarize(parse(text))
+     */
+    TextToBinary(bool keep_order = false):_keep_order(keep_order) {}
+
+    ///Write some text
+    /**
+     * @param text text
+     * @retval true need more data
+     * @retval false done, check is_error()
+     */
+    bool write(std::string_view text);
+
+    ///Read generated binary content
+    /**
+     * @return content generated since last read. Returned string is valid
+     * until next call of the read()
+     */
+    std::string_view read() {return _writer.read();}
+
+    ///Retrieve error status
+    bool is_error() const {return _is_error;}
+
+    ///Retrieve unprocessed data (valid when write() returned false)
+    std::string_view get_unprocessed_data() const {
+        return std::string_view(_pos, std::distance(_pos, _end));
+    }
+
+protected:
+
+    enum class Step {
+        //expecting value
+        value,
+        //container has been opened, expecting first item or end
+        first_item,
+        //expecting key of object
+        key,
+        //expecting colon after key
+        colon,
+        //expecting comma or end of container
+        next,
+        //whole value has been transcoded
+        done
+    };
+
+    //object which is sorted before it is written
+    struct SortedObject {
+        //content of the current item
+        BinaryStreamWriter writer;
+        std::string key;
+        //key and encoded value of finished items
+        std::vector<std::pair<std::string, std::string> > items;
+    };
+
+    bool _keep_order;
+    bool _is_error = false;
+    bool _sub_active = false;
+    Step _step = Step::value;
+    //true for object, false for array
+    std::vector<bool> _levels;
+    //open objects when the order is not kept
+    std::vector<SortedObject> _objects;
+    Parser<ParserEmptyPreprocesor, Format::text> _sub;
+    BinaryStreamWriter _writer;
+
+    BinaryStreamWriter &writer() {
+        return _objects.empty()?_writer:_objects.back().writer;
+    }
+    std::string_view::iterator _pos = {};
+    std::string_view::iterator _end = {};
+
+    void start_value();
+    void finish_value(const Value &v);
+    void close_container();
+    void after_value();
+    bool error() {_is_error = true; return false;}
+};
+
+///Converts binary format to JSON text without building the document
+/**
+ * The transcoder reads binary format in chunks and generates text in chunks. Strings
+ * are converted as they arrive, so memory usage is limited by size of the
+ * largest key.
+ *
+ * Output is the same as generated by the Serializer, with following exceptions.
+ * Undefined items and keys with undefined value are dropped. References to shared
+ * containers (see SharedRefs) are not supported, they are reported as error
+ */
+class BinaryToText {
+public:
+
+    ///Write some binary data
+    /**
+     * @param data binary data
+     * @retval true need more data
+     * @retval false done, check is_error()
+     */
+    bool write(std::string_view data);
+
+    ///Read generated text
+    /**
+     * @return content generated since last read. Returned string is valid
+     * until next call of the read()
+     */
+    std::string_view read();
+
+    ///Retrieve error status
+    bool is_error() const {return _is_error;}
+
+    ///Retrieve unprocessed data (valid when write() returned false)
+    std::string_view get_unprocessed_data() const {
+        return std::string_view(_pos, std::distance(_pos, _end));
+    }
+
+protected:
+
+    enum class Step {
+        //reading tag
+        tag,
+        //reading length or numeric value
+        length,
+        //reading content of string
+        string,
+        //reading key
+        key,
+        //reading double number
+        double_number,
+        //whole value has been transcoded
+        done
+    };
+
+    struct Level {
+        bool object;
+        bool indefinite;
+        bool first = true;
+        bool reading_key = false;
+        //remaining items (pairs for objects)
+        std::uint64_t remain = 0;
+    };
+
+    Step _step = Step::tag;
+    bool _is_error = false;
+    unsigned char _tag = 0;
+    unsigned int _len_bytes = 0;
+    std::uint64_t _accum = 0;
+    std::string _key;
+    std::string _double;
+    std::vector<Level> _levels;
+    std::string _out_buff;
+    std::string _read_buff;
+    std::string_view::iterator _pos = {};
+    std::string_view::iterator _end = {};
+
+    bool read_tag();
+    bool finish_length();
+    void write_prefix();
+    void write_text(std::string_view text);
+    void open_container(bool object, bool indefinite, std::uint64_t count);
+    void item_done();
+    bool error() {_is_error = true; return false;}
+};
+
+///Convert JSON text to binary format
+/**
+ * @param text JSON text
+ * @param keep_order keep source order of keys
+ * @return binary format
+ * @exception ParseError parse error
+ */
+inline std::string transcode_to_binary(std::string_view text, bool keep_order = false) {
+    TextToBinary tc(keep_order);
+    std::string retval;
+    bool need_more = tc.write(text);
+    retval.append(tc.read());
+    if (need_more) throw ParseError(text.size());
+    if (tc.is_error()) throw ParseError(text.size() - tc.get_unprocessed_data().size());
+    return retval;
+}
+
+///Convert binary format to JSON text
+/**
+ * @param bin binary format
+ * @return JSON text
+ * @exception ParseError parse error
+ */
+inline std::string transcode_to_text(std::string_view bin) {
+    BinaryToText tc;
+    std::string retval;
+    bool need_more = tc.write(bin);
+    retval.append(tc.read());
+    if (need_more) throw ParseError(bin.size());
+    if (tc.is_error()) throw ParseError(bin.size() - tc.get_unprocessed_data().size());
+    return retval;
+}
+
+
+inline bool TextToBinary::write(std::string_view text) {
+    _pos = text.begin();
+    _end = text.end();
+    while (true) {
+        if (_sub_active) {
+            std::string_view rest(_pos, std::distance(_pos, _end));
+            if (_sub.write(rest)) {
+                _pos = _end;
+                return true;
+            }
+            _pos = _end - _sub.get_unprocessed_data().size();
+            if (_sub.is_error()) return error();
+            _sub_active = false;
+            finish_value(_sub.get_result());
+            continue;
+        }
+        if (_step == Step::done || _is_error) return false;
+        while (_pos != _end && std::isspace(*_pos)) ++_pos;
+        if (_pos == _end) return true;
+        char c = *_pos;
+        switch (_step) {
+            case Step::value:
+                start_value();
+                break;
+            case Step::first_item:
+                if (c == (_levels.back()?'}':']')) {
+                    close_container();
+                } else {
+                    _step = _levels.back()?Step::key:Step::value;
+                }
+                break;
+            case Step::key:
+                if (c != '"') return error();
+                _sub.reset();
+                _sub_active = true;
+                break;
+            case Step::colon:
+                if (c != ':') return error();
+                ++_pos;
+                _step = Step::value;
+                break;
+            case Step::next:
+                if (c == ',') {
+                    ++_pos;
+                    _step = _levels.back()?Step::key:Step::value;
+                } else if (c == (_levels.back()?'}':']')) {
+                    close_container();
+                } else {
+                    return error();
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+}
+
+inline void TextToBinary::start_value() {
+    char c = *_pos;
+    if (c == '[') {
+        ++_pos;
+        writer().begin_array();
+        _levels.push_back(false);
+        _step = Step::first_item;
+    } else if (c == '{') {
+        ++_pos;
+        if (_keep_order) writer().begin_object();
+        else _objects.emplace_back();
+        _levels.push_back(true);
+        _step = Step::first_item;
+    } else {
+        //scalars are processed by the parser
+        _sub.reset();
+        _sub_active = true;
+    }
+}
+
+inline void TextToBinary::finish_value(const Value &v) {
+    if (_step == Step::key) {
+        if (_keep_order) _writer.key(v.get_string());
+        else _objects.back().key = v.get_string();
+        _step = Step::colon;
+    } else {
+        writer().write(v);
+        after_value();
+    }
+}
+
+inline void TextToBinary::close_container() {
+    ++_pos;
+    bool object = _levels.back();
+    _levels.pop_back();
+    if (object && !_keep_order) {
+        auto items = std::move(_objects.back().items);
+        _objects.pop_back();
+        std::stable_sort(items.begin(), items.end(), [](const auto &a, const auto &b){
+            return a.first < b.first;
+        });
+        //keep first of duplicate keys
+        items.erase(std::unique(items.begin(), items.end(), [](const auto &a, const auto &b){
+            return a.first == b.first;
+        }), items.end());
+        std::string header;
+        render_binary_type_size(BinaryType::object, items.size(), std::back_inserter(header));
+        BinaryStreamWriter &w = writer();
+        w.write_raw(header);
+        for (const auto &[k, content]: items) {
+            w.key(k);
+            w.write_raw(content);
+        }
+    } else {
+        writer().end();
+    }
+    after_value();
+}
+
+inline void TextToBinary::after_value() {
+    if (!_keep_order && !_levels.empty() && _levels.back()) {
+        //item of the sorted object is complete
+        SortedObject &obj = _objects.back();
+        obj.items.emplace_back(std::move(obj.key), std::string(obj.writer.read()));
+        obj.key.clear();
+    }
+    _step = _levels.empty()?Step::done:Step::next;
+}
+
+inline bool BinaryToText::write(std::string_view data) {
+    _pos = data.begin();
+    _end = data.end();
+    while (_pos != _end) {
+        switch (_step) {
+            case Step::tag:
+                if (!read_tag()) return false;
+                break;
+            case Step::length:
+                while (_pos != _end && _len_bytes) {
+                    _accum = (_accum << 8) | static_cast<unsigned char>(*_pos++);
+                    --_len_bytes;
+                }
+                if (!_len_bytes && !finish_length()) return false;
+                break;
+            case Step::string: {
+                std::size_t avail = std::distance(_pos, _end);
+                std::size_t cnt = static_cast<std::size_t>(std::min<std::uint64_t>(_accum, avail));
+                std::string_view part(_pos, cnt);
+                _pos += cnt;
+                _accum -= cnt;
+                if ((_tag & BinaryType::mask) == BinaryType::string_number) {
+                    _out_buff.append(part);
+                } else {
+                    Serializer<>::encode(part, _out_buff);
+                }
+                if (!_accum) {
+                    if ((_tag & BinaryType::mask) == BinaryType::string) _out_buff.push_back('"');
+                    item_done();
+                }
+            }break;
+            case Step::key: {
+                std::size_t avail = std::distance(_pos, _end);
+                std::size_t cnt = static_cast<std::size_t>(std::min<std::uint64_t>(_accum, avail));
+                _key.append(_pos, _pos + cnt);
+                _pos += cnt;
+                _accum -= cnt;
+                if (!_accum) {
+                    _levels.back().reading_key = false;
+                    _step = Step::tag;
+                }
+            }break;
+            case Step::double_number:
+                _double.push_back(*_pos++);
+                if (_double.size() == sizeof(double)) {
+                    double v;
+                    std::memcpy(&v, _double.data(), sizeof(v));
+                    write_prefix();
+                    Serializer<> ser(v);
+                    write_text(ser.read());
+                    item_done();
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+    return _step != Step::done;
+}
+
+inline bool BinaryToText::read_tag() {
+    unsigned char type = *_pos++;
+    unsigned char maj = type & BinaryType::mask;
+    _tag = type;
+    bool reading_key = !_levels.empty() && _levels.back().reading_key;
+    if (reading_key && type != BinaryType::container_end && maj != BinaryType::string) {
+        return error();
+    }
+    switch (maj) {
+        case BinaryType::simple:
+            switch (type) {
+                case BinaryType::null:
+                    write_prefix();
+                    write_text(null_value);
+                    item_done();
+                    break;
+                case BinaryType::bool_true:
+                case BinaryType::bool_false:
+                    write_prefix();
+                    write_text(type == BinaryType::bool_true?true_value:false_value);
+                    item_done();
+                    break;
+                case BinaryType::double_number:
+                    _double.clear();
+                    _step = Step::double_number;
+                    break;
+                case BinaryType::indefinite_array:
+                case BinaryType::indefinite_object:
+                    open_container(type == BinaryType::indefinite_object, true, 0);
+                    break;
+                case BinaryType::container_end: {
+                    if (_levels.empty()) return error();
+                    Level &l = _levels.back();
+                    if (!l.indefinite || (l.object && !l.reading_key)) return error();
+                    _out_buff.push_back(l.object?'}':']');
+                    _levels.pop_back();
+                    item_done();
+                } break;
+                default:
+                    //undefined, key of undefined value is dropped
+                    if (_levels.empty()) write_text(null_value);
+                    _key.clear();
+                    item_done();
+                    break;
+            }
+            return true;
+        case BinaryType::p_number:
+        case BinaryType::n_number:
+        case BinaryType::string:
+        case BinaryType::string_number:
+        case BinaryType::array:
+        case BinaryType::object:
+            _len_bytes = (type & BinaryType::size_mask) + 1;
+            _accum = 0;
+            _step = Step::length;
+            return true;
+        default:
+            //header of shared references is skipped, references are not supported
+            if (type == BinaryType::shared_refs && _levels.empty()) return true;
+            return error();
+    }
+}
+
+inline bool BinaryToText::finish_length() {
+    unsigned char maj = _tag & BinaryType::mask;
+    switch (maj) {
+        case BinaryType::p_number:
+        case BinaryType::n_number:
+            write_prefix();
+            if (maj == BinaryType::n_number) _out_buff.push_back('-');
+            render_unsigned_number(_accum, std::back_inserter(_out_buff));
+            item_done();
+            break;
+        case BinaryType::string:
+            if (!_levels.empty() && _levels.back().reading_key) {
+                _key.clear();
+                _step = Step::key;
+                if (!_accum) {
+                    _levels.back().reading_key = false;
+                    _step = Step::tag;
+                }
+                break;
+            }
+            [[fallthrough]];
+        case BinaryType::string_number:
+            write_prefix();
+            if (maj == BinaryType::string) _out_buff.push_back('"');
+            _step = Step::string;
+            if (!_accum) {
+                if (maj == BinaryType::string) _out_buff.push_back('"');
+                else return error();
+                item_done();
+            }
+            break;
+        default:
+            open_container(maj == BinaryType::object, false, _accum);
+            break;
+    }
+    return true;
+}
+
+inline void BinaryToText::write_prefix() {
+    if (_levels.empty()) return;
+    Level &l = _levels.back();
+    if (!l.first) _out_buff.push_back(',');
+    l.first = false;
+    if (l.object) {
+        _out_buff.push_back('"');
+        Serializer<>::encode(_key, _out_buff);
+        _out_buff.push_back('"');
+        _out_buff.push_back(':');
+    }
+}
+
+inline void BinaryToText::write_text(std::string_view text) {
+    _out_buff.append(text);
+}
+
+inline void BinaryToText::open_container(bool object, bool indefinite, std::uint64_t count) {
+    write_prefix();
+    _out_buff.push_back(object?'{':'[');
+    if (!indefinite && !count) {
+        _out_buff.push_back(object?'}':']');
+        item_done();
+        return;
+    }
+    _levels.push_back(Level{object, indefinite, true, object, count});
+    _step = Step::tag;
+}
+
+inline void BinaryToText::item_done() {
+    _step = Step::tag;
+    while (!_levels.empty()) {
+        Level &l = _levels.back();
+        if (l.object) l.reading_key = true;
+        if (l.indefinite || --l.remain) return;
+        _out_buff.push_back(l.object?'}':']');
+        _levels.pop_back();
+    }
+    _step = Step::done;
+}
+
+inline std::string_view BinaryToText::read() {
+    std::swap(_out_buff, _read_buff);
+    _out_buff.clear();
+    return _read_buff;
+}
+
+}
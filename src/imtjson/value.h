@@ -3,12 +3,21 @@
 
 #include <type_traits>
 #include <atomic>
+#include <bit>
 #include <cstdint>
 #include <limits>
 #include <memory>
 #include <span>
 #include <vector>
 #include <algorithm>
+#include <charconv>
+#include <string>
+#include <memory_resource>
+#include <new>
+#include <typeinfo>
+#ifdef IMTJSON_NON_ATOMIC_REFCOUNT
+#include <cassert>
+#endif
 
 
 namespace json {
@@ -26,16 +35,75 @@ enum class Type : char {
 template<typename T, typename Result, typename ... Args>
 concept InvokableResult = std::constructible_from<Result, decltype(std::declval<T>()(std::declval<Args>()...))>;
 
+#ifdef IMTJSON_NON_ATOMIC_REFCOUNT
+namespace _details {
+
+///Reference counter without atomic operations
+/**
+ * Used when IMTJSON_NON_ATOMIC_REFCOUNT is defined. Values must not be shared
+ * between threads. Headers parallel.h and atomic_value.h can't be used
+ * in this mode.
+ *
+ * When IMTJSON_REFCOUNT_THREAD_CHECK is defined too (it must be the same for the
+ * whole program, it changes size of the counter), the counter asserts that
+ * a shared object is changed only by the thread which owns it. An object held by
+ * a single reference can be moved to other thread, which becomes the new owner
+ */
+class PlainCounter {
+public:
+    constexpr PlainCounter(unsigned long v):_v(v) {}
+    unsigned long load(std::memory_order) const {return _v;}
+    void store(unsigned long v, std::memory_order) {_v = v;}
+    unsigned long fetch_add(unsigned long v, std::memory_order) {
+        check_thread();
+        unsigned long r = _v;
+        _v += v;
+        return r;
+    }
+    unsigned long fetch_sub(unsigned long v, std::memory_order) {
+        check_thread();
+        unsigned long r = _v;
+        _v -= v;
+        return r;
+    }
+protected:
+    unsigned long _v;
+#ifdef IMTJSON_REFCOUNT_THREAD_CHECK
+    //address of a thread local variable identifies the owning thread
+    const void *_owner = nullptr;
+    void check_thread() {
+        static thread_local char thread_marker;
+        //single reference is not shared, the current thread takes it over
+        if (_v <= 1) _owner = &thread_marker;
+        assert(_owner == &thread_marker && "Value is shared between threads (IMTJSON_NON_ATOMIC_REFCOUNT)");
+    }
+#else
+    void check_thread() {}
+#endif
+};
+
+}
+
+using RefCounter = _details::PlainCounter;
+#else
+using RefCounter = std::atomic<unsigned long>;
+#endif
+
 class RefCounted {
 public:
 
     constexpr RefCounted()
         :_refcnt(std::is_constant_evaluated()*std::numeric_limits<long>::max()) {}
 
+    ///Reference count from which the object is immortal (it is never released)
+    static constexpr unsigned long immortal_base = std::numeric_limits<unsigned long>::max() / 4;
+
     void add_ref() const {
+        if (is_immortal()) return;
         _refcnt.fetch_add(1, std::memory_order_relaxed);
     }
     bool release_ref() const {
+        if (is_immortal()) return false;
         if (_refcnt.fetch_sub(1, std::memory_order_release) <= 1) {
             _refcnt.load(std::memory_order_acquire);
             return true;
@@ -50,14 +118,100 @@ public:
         }
     };
 
+    ///Object is not reference counted (static object, frozen object or object allocated in an arena)
+    bool is_immortal() const {
+        return _refcnt.load(std::memory_order_relaxed) >= immortal_base;
+    }
+
+    ///Object is frozen (see freeze())
+    bool is_frozen() const {
+        auto c = _refcnt.load(std::memory_order_relaxed);
+        return c >= immortal_base && c < immortal_base * 2;
+    }
+
+    ///Stop reference counting of the object
+    /**
+     * The original reference count is kept, so the object can be thawed later
+     *
+     * @retval true object has been frozen
+     * @retval false object is already immortal
+     */
+    bool freeze() const {
+        if (is_immortal()) return false;
+        _refcnt.fetch_add(immortal_base, std::memory_order_relaxed);
+        return true;
+    }
+
+    ///Restore reference counting of a frozen object
+    /**
+     * @retval true object has been thawed
+     * @retval false object was not frozen
+     */
+    bool thaw() const {
+        if (!is_frozen()) return false;
+        _refcnt.fetch_sub(immortal_base, std::memory_order_acq_rel);
+        return true;
+    }
+
 protected:
-    mutable std::atomic<unsigned long> _refcnt;
+    mutable RefCounter _refcnt;
+
+    void make_immortal() {
+        _refcnt.store(immortal_base * 2, std::memory_order_relaxed);
+    }
+};
+
+///Memory resource for containers which are released all at once
+/**
+ * Containers allocated from this resource are immortal. They are not reference
+ * counted and they are never destroyed individually, the memory is released
+ * together with the resource (see Document)
+ */
+class ArenaResource final: public std::pmr::monotonic_buffer_resource {
+public:
+    using std::pmr::monotonic_buffer_resource::monotonic_buffer_resource;
 };
 
 
 template<typename T>
 class Container;
 
+///Flags which cache results of inspection of the container
+/**
+ * Content of the container is immutable, so once the flag is set, it is valid
+ * for whole lifetime of the container
+ */
+namespace ContainerFlag {
+    ///string doesn't contain characters which need to be escaped
+    constexpr unsigned char clean_text = 0x01;
+    ///object has been inspected for undefined values (flag undefined_keys is valid)
+    constexpr unsigned char undefined_checked = 0x02;
+    ///object contains undefined value or key undef_key_name, text format needs transformation
+    constexpr unsigned char undefined_keys = 0x04;
+}
+
+///Base class of data attached to a container
+/**
+ * Attachments store data derived from content of the container (for example
+ * cached serialization). They are destroyed together with the container. Each
+ * attachment is identified by an address (id), which is unique for its kind.
+ */
+class ContainerAttachment {
+public:
+    ContainerAttachment(const void *id):_id(id) {}
+    virtual ~ContainerAttachment() = default;
+    ContainerAttachment(const ContainerAttachment &) = delete;
+    ContainerAttachment &operator=(const ContainerAttachment &) = delete;
+
+    const void *id() const {return _id;}
+
+protected:
+    const void *_id;
+    ContainerAttachment *_next = nullptr;
+
+    template<typename T> friend class Container;
+};
+
 template<typename T>
 using PContainer = std::unique_ptr<Container<T>, RefCounted::Deleter>;
 
@@ -106,11 +260,73 @@ public:
 
     virtual constexpr ~Container() {
         for (T &x:*this) std::destroy_at(&x);
+        if (!std::is_constant_evaluated()) {
+            ContainerAttachment *att = _attachments.load(std::memory_order_acquire);
+            while (att) {
+                ContainerAttachment *n = att->_next;
+                delete att;
+                att = n;
+            }
+        }
     }
 
     Container(const Container &) = delete;
     Container &operator=(const Container &) = delete;
 
+    ///Test flag (see ContainerFlag)
+    bool test_flag(unsigned char flag) const {
+        return (_flags.load(std::memory_order_relaxed) & flag) != 0;
+    }
+    ///Set flag (see ContainerFlag)
+    void set_flag(unsigned char flag) const {
+        _flags.fetch_or(flag, std::memory_order_relaxed);
+    }
+
+    ///Count a lookup in the container
+    /**
+     * The counter is not exact, concurrent lookups can be counted once
+     *
+     * @param limit count of lookups to reach
+     * @retval true limit has been reached
+     * @retval false counted, limit not reached yet
+     */
+    bool count_lookup(unsigned char limit) const {
+        unsigned char n = _lookups.load(std::memory_order_relaxed);
+        if (n >= limit) return true;
+        _lookups.store(n + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    ///Find attachment
+    /**
+     * @param id id of the attachment
+     * @return pointer to attachment or nullptr if not found
+     */
+    const ContainerAttachment *find_attachment(const void *id) const {
+        const ContainerAttachment *att = _attachments.load(std::memory_order_acquire);
+        while (att && att->_id != id) att = att->_next;
+        return att;
+    }
+
+    ///Attach data to the container
+    /**
+     * The function is thread safe. If an attachment with the same id has been
+     * attached by other thread, the new attachment is discarded
+     *
+     * @param att attachment
+     * @return attachment which is attached to the container under the given id
+     */
+    const ContainerAttachment *attach(std::unique_ptr<ContainerAttachment> att) const {
+        ContainerAttachment *head = _attachments.load(std::memory_order_acquire);
+        do {
+            for (ContainerAttachment *x = head; x; x = x->_next) {
+                if (x->_id == att->_id) return x;
+            }
+            att->_next = head;
+        } while (!_attachments.compare_exchange_weak(head, att.get(), std::memory_order_acq_rel));
+        return att.release();
+    }
+
     constexpr bool operator==(const Container &other)  const {
         if (_sz != other._sz) return false;
         if (_ptr == other._ptr) return true;
@@ -121,21 +337,26 @@ public:
     }
 
 
-    static PContainer<T> create(const T *ptr, std::size_t sz) {
-        AllocInfo info = {sz};
+    ///Memory resource used to allocate the container (nullptr - global heap)
+    std::pmr::memory_resource *get_memory_resource() const {return _resource;}
+    ///Container is allocated in an arena (ArenaResource), it is released with the arena
+    bool in_arena() const {return _resource && is_immortal() && !is_frozen();}
+
+    static PContainer<T> create(const T *ptr, std::size_t sz, std::pmr::memory_resource *resource = nullptr) {
+        AllocInfo info = {sz, resource};
         auto out = new(info) Container<T> (info,ptr);
         out->add_ref();
         return PContainer<T>(out);
     }
-    static PContainer<T> create_move_in(T *ptr, std::size_t sz) {
-        AllocInfo info = {sz};
+    static PContainer<T> create_move_in(T *ptr, std::size_t sz, std::pmr::memory_resource *resource = nullptr) {
+        AllocInfo info = {sz, resource};
         auto out = new(info) Container<T> (info,ptr);
         out->add_ref();
         return PContainer<T>(out);
     }
 
-    static PContainer<T> create(std::size_t sz) {
-        AllocInfo info = {sz};
+    static PContainer<T> create(std::size_t sz, std::pmr::memory_resource *resource = nullptr) {
+        AllocInfo info = {sz, resource};
         auto out = new(info) Container<T>(info);
         out->add_ref();
         return PContainer<T>(out);
@@ -164,8 +385,8 @@ public:
         T *_end;
     };
 
-    static Builder create_builder(std::size_t sz) {
-        AllocInfo info = {sz};
+    static Builder create_builder(std::size_t sz, std::pmr::memory_resource *resource = nullptr) {
+        AllocInfo info = {sz, resource};
         T *beg;
         T *end;
         auto out = new(info) Container<T>(info, beg, end);
@@ -176,49 +397,80 @@ public:
 protected:
     const T *_ptr;
     std::size_t _sz;
-
+    mutable std::atomic<unsigned char> _flags = 0;
+    //count of lookups (see count_lookup), it uses padding before _attachments
+    mutable std::atomic<unsigned char> _lookups = 0;
+    mutable std::atomic<ContainerAttachment *> _attachments = nullptr;
+    //resource which allocated the container (nullptr = global heap)
+    std::pmr::memory_resource *_resource = nullptr;
+    //size of the allocation (needed to return memory to the resource)
+    std::size_t _alloc_size = 0;
+
+    static constexpr std::size_t alloc_align = alignof(std::max_align_t);
+
+    void init_resource() {
+        //ArenaResource is final, exact type test is cheaper than dynamic_cast
+        if (_resource && typeid(*_resource) == typeid(ArenaResource)) make_immortal();
+    }
 
     struct AllocInfo { // @suppress("Miss copy constructor or assignment operator")
         std::size_t sz;
+        std::pmr::memory_resource *resource = nullptr;
         T *buffer = nullptr;
+        std::size_t total_size = 0;
     };
 
 
-    Container(AllocInfo &info):_ptr(info.buffer), _sz(info.sz) {
+    Container(AllocInfo &info):_ptr(info.buffer), _sz(info.sz)
+        ,_resource(info.resource),_alloc_size(info.total_size) {
+        init_resource();
         for (auto &target: *this) std::construct_at(&target);
     }
 
-    Container(AllocInfo &info, const T *source):_ptr(info.buffer), _sz(info.sz) {
+    Container(AllocInfo &info, const T *source):_ptr(info.buffer), _sz(info.sz)
+        ,_resource(info.resource),_alloc_size(info.total_size) {
+        init_resource();
         for (auto &target: *this) {
             std::construct_at(&target, *source);
             ++source;
         }
     }
-    Container(AllocInfo &info, T *source):_ptr(info.buffer), _sz(info.sz) {
+    Container(AllocInfo &info, T *source):_ptr(info.buffer), _sz(info.sz)
+        ,_resource(info.resource),_alloc_size(info.total_size) {
+        init_resource();
         for (auto &target: *this) {
             std::construct_at(&target, std::move(*source));
             ++source;
         }
     }
-    Container(AllocInfo &info, T *& beg, T *& end):_ptr(info.buffer), _sz(0) {
+    Container(AllocInfo &info, T *& beg, T *& end):_ptr(info.buffer), _sz(0)
+        ,_resource(info.resource),_alloc_size(info.total_size) {
+        init_resource();
         beg = info.buffer;
         end = info.buffer+info.sz;
     }
 
 
     void *operator new(std::size_t sz, AllocInfo &info) {
-        std::size_t total_size = sz + sizeof(T)*info.sz;
-        void *out = ::operator new(total_size);
+        info.total_size = sz + sizeof(T)*info.sz;
+        void *out = info.resource?info.resource->allocate(info.total_size, alloc_align)
+                                 : ::operator new(info.total_size);
         info.buffer = reinterpret_cast<T *>(reinterpret_cast<char *>(out) + sz);
         return out;
     }
-    void operator delete(void *ptr, AllocInfo &) {
-        ::operator delete(ptr);
+    void operator delete(void *ptr, AllocInfo &info) {
+        if (info.resource) info.resource->deallocate(ptr, info.total_size, alloc_align);
+        else ::operator delete(ptr);
     }
 
 public:
-    void operator delete(void *ptr, std::size_t) {
-        ::operator delete(ptr);
+    ///Destroys the container and returns memory to the resource which allocated it
+    void operator delete(Container *ptr, std::destroying_delete_t) {
+        std::pmr::memory_resource *resource = ptr->_resource;
+        std::size_t sz = ptr->_alloc_size;
+        ptr->~Container();
+        if (resource) resource->deallocate(ptr, sz, alloc_align);
+        else ::operator delete(ptr);
     }
 };
 
@@ -300,6 +552,7 @@ public:
 };
 class IsNumber {};
 class Value;
+class KeyLiteral;
 
 constexpr std::string_view infinity="∞";
 constexpr std::string_view neg_infinity="-∞";
@@ -391,7 +644,13 @@ public:
     constexpr Value();
     constexpr ~Value();
 
-    constexpr Value(std::string_view str, bool is_number = false);
+    ///Construct string
+    /**
+     * @param str string
+     * @param is_number string contains a number
+     * @param resource memory resource used to allocate long string (nullptr - global heap)
+     */
+    constexpr Value(std::string_view str, bool is_number = false, std::pmr::memory_resource *resource = nullptr);
     constexpr Value(const char * str):Value(std::string_view(str)) {}
 
     constexpr Value(short val);
@@ -410,15 +669,15 @@ public:
     Value(PCustomValue custom);
 
 
-    Value(const std::vector<Value> &arr);
-    Value(std::vector<Value> &&arr);
+    Value(const std::vector<Value> &arr, std::pmr::memory_resource *resource = nullptr);
+    Value(std::vector<Value> &&arr, std::pmr::memory_resource *resource = nullptr);
     template<size_t _Extent>
     Value(const std::span<const Value, _Extent> &arr);
     template<size_t _Extent>
     Value(std::span<Value, _Extent> &&arr);
 
-    Value(const std::vector<KeyValue> &arr);
-    Value(std::vector<KeyValue> &&arr);
+    Value(const std::vector<KeyValue> &arr, std::pmr::memory_resource *resource = nullptr);
+    Value(std::vector<KeyValue> &&arr, std::pmr::memory_resource *resource = nullptr);
     template<size_t _Extent>
     Value(const std::span<const KeyValue, _Extent> &arr);
     template<size_t _Extent>
@@ -467,6 +726,8 @@ public:
 
     const Value &operator[](const std::string_view &key) const;
     const Value &operator[](unsigned int index) const;
+    ///Access value by a key literal (obj["name"_key])
+    const Value &operator[](const KeyLiteral &key) const;
 
     ///Retrieve whether value is defined
     /**
@@ -709,6 +970,23 @@ public:
 
     constexpr Storage get_storage() const {return _storage;}
 
+    ///Retrieve container of the long string
+    /**
+     * @return pointer to container if the value is stored as long string, otherwise nullptr
+     */
+    constexpr const Container<char> *get_string_container() const {
+        return _storage == Storage::long_string?_un.long_str:nullptr;
+    }
+
+    ///Retrieve container of the long string or the long number
+    /**
+     * @return pointer to container if the value is stored as long string or long number,
+     * otherwise nullptr
+     */
+    constexpr const Container<char> *get_text_container() const {
+        return _storage == Storage::long_string || _storage == Storage::long_number?_un.long_str:nullptr;
+    }
+
 protected:
 
     struct StringRef { // @suppress("Miss copy constructor or assignment operator")
@@ -733,20 +1011,22 @@ protected:
     Un _un;
     Storage _storage;
 
+    friend struct KeyCompare;
+
 
 
     static constexpr void release(Value &v);
     static constexpr void add_ref(Value &v);
 
     template<typename X>
-    void init_array(const X &x);
+    void init_array(const X &x, std::pmr::memory_resource *resource = nullptr);
     template<typename X>
-    void init_array_move(X &&x);
+    void init_array_move(X &&x, std::pmr::memory_resource *resource = nullptr);
 
     template<typename X>
-    void init_object(const X &x);
+    void init_object(const X &x, std::pmr::memory_resource *resource = nullptr);
     template<typename X>
-    void init_object_move(X &&x);
+    void init_object_move(X &&x, std::pmr::memory_resource *resource = nullptr);
 
     template<typename Num>
     constexpr void init_integral(Num num) {
@@ -779,14 +1059,14 @@ public:
     Key(const std::string &val):_str(std::string_view(val)) {}
     constexpr operator std::string_view() const {return _str.get_string();}
     operator std::string() const {return std::string(_str.get_string());}
-    const Value &to_value() const {return _str;}
+    constexpr const Value &to_value() const {return _str;}
     constexpr const char *c_str() const {return _str.get_string().data();}
     constexpr std::size_t size() const {return _str.get_string().size();}
     constexpr bool empty() const {return _str.get_string().empty();}
     constexpr std::string_view get_string() const {return _str.get_string();}
     constexpr std::string_view get() const {return _str.get_string();}
     constexpr auto compare(const std::string_view &other) const {return _str.get_string().compare(other);}
-    constexpr auto operator<=>(const Key &other) const {return compare(other);}
+    constexpr auto operator<=>(const Key &other) const;
     constexpr bool operator==(const Key &other) const  = default;
 
 
@@ -813,6 +1093,110 @@ struct KeyValue {
     }
 };
 
+///Calculate hash of a key (FNV-1a)
+constexpr std::uint64_t key_hash(std::string_view key) {
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (char c: key) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+///Comparator of keys
+/**
+ * Short keys are stored inline zero-padded, followed by the storage byte which
+ * contains the length. Such keys are compared as two big-endian 64-bit words,
+ * which gives the same order as comparison of strings. Other keys are compared
+ * as strings.
+ */
+struct KeyCompare {
+
+    ///Three-way comparison of keys
+    /**
+     * @param a first key
+     * @param b second key
+     * @retval <0 a < b
+     * @retval 0 a == b
+     * @retval >0 a > b
+     */
+    static constexpr int compare(const Value &a, const Value &b) {
+        if (!std::is_constant_evaluated() && is_inline(a) && is_inline(b)) {
+            std::uint64_t a0 = word(a, 0);
+            std::uint64_t b0 = word(b, 0);
+            if (a0 != b0) return a0 < b0?-1:1;
+            std::uint64_t a1 = word(a, 8);
+            std::uint64_t b1 = word(b, 8);
+            return a1 < b1?-1:a1 > b1?1:0;
+        }
+        return a.get_string().compare(b.get_string());
+    }
+
+    static constexpr int compare(const Key &a, const Key &b) {
+        return compare(a.to_value(), b.to_value());
+    }
+
+    constexpr bool operator()(const KeyValue &a, const KeyValue &b) const {
+        return compare(a.key, b.key) < 0;
+    }
+    constexpr bool operator()(const Key &a, const Key &b) const {
+        return compare(a, b) < 0;
+    }
+
+protected:
+
+    static constexpr bool is_inline(const Value &v) {
+        return static_cast<unsigned char>(v._storage) < static_cast<unsigned char>(Storage::short_string_top);
+    }
+
+    static std::uint64_t word(const Value &v, unsigned int offset) {
+        static_assert(sizeof(Value) == 16 && sizeof(Value::Un) == 15);
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(&v) + offset;
+        //compilers translate this to a load and a byte swap
+        std::uint64_t r = 0;
+        for (unsigned int i = 0; i < 8; ++i) r = (r << 8) | p[i];
+        return r;
+    }
+};
+
+constexpr auto Key::operator<=>(const Key &other) const {
+    return KeyCompare::compare(*this, other);
+}
+
+///Key known at compile time
+/**
+ * Carries key in the same representation as it is stored in objects, and
+ * its precomputed hash. Construct it by the literal operator "name"_key
+ */
+class KeyLiteral {
+public:
+    explicit constexpr KeyLiteral(std::string_view key):_key(key),_hash(key_hash(key)) {}
+
+    constexpr const Key &key() const {return _key;}
+    constexpr std::uint64_t hash() const {return _hash;}
+    constexpr std::string_view get_string() const {return _key.get_string();}
+    constexpr operator std::string_view() const {return _key.get_string();}
+
+protected:
+    Key _key;
+    std::uint64_t _hash;
+};
+
+inline namespace literals {
+
+///Create key literal
+/**
+ * @code
+ * using namespace json::literals;
+ * auto ts = obj["timestamp"_key];
+ * @endcode
+ */
+consteval KeyLiteral operator""_key(const char *str, std::size_t len) {
+    return KeyLiteral(std::string_view(str, len));
+}
+
+}
+
 class Array: public Value {
 public:
     constexpr Array():Value(Type::array) {}
@@ -926,7 +1310,7 @@ inline constexpr Value &Value::operator=(Value &&other) {
     return *this;
 }
 
-inline constexpr Value::Value(std::string_view str, bool is_number)
+inline constexpr Value::Value(std::string_view str, bool is_number, std::pmr::memory_resource *resource)
 {
     if (str.size() < 15) {
         _un.short_str[14] = 0; // activate variant
@@ -940,7 +1324,7 @@ inline constexpr Value::Value(std::string_view str, bool is_number)
         _un.str_ref.sz = static_cast<std::uint32_t>(str.size());
         _storage = is_number?Storage::number_ref:Storage::string_ref;
     } else {
-        _un.long_str = Container<char>::create(str.data(),str.size()).release();
+        _un.long_str = Container<char>::create(str.data(),str.size(),resource).release();
         _storage = is_number?Storage::long_number:Storage::long_string;
     }
 }
@@ -972,69 +1356,89 @@ inline constexpr Type Value::type() const  {
 }
 
 template<typename X>
-inline void Value::init_array(const X &arr) {
+inline void Value::init_array(const X &arr, std::pmr::memory_resource *resource) {
     if (arr.empty()) {
         _storage = Storage::empty_array;
     } else {
-        _un.array = Container<Value>::create(arr.data(), arr.size()).release();
+        _un.array = Container<Value>::create(arr.data(), arr.size(), resource).release();
         _storage = Storage::array;
     }
 }
 template<typename X>
-inline void Value::init_array_move(X &&arr) {
+inline void Value::init_array_move(X &&arr, std::pmr::memory_resource *resource) {
     if (arr.empty()) {
         _storage = Storage::empty_array;
     } else {
-        _un.array = Container<Value>::create_move_in(arr.data(), arr.size()).release();;
+        _un.array = Container<Value>::create_move_in(arr.data(), arr.size(), resource).release();
         _storage = Storage::array;
     }
 }
 
-inline bool sort_object(Container<KeyValue> &cont) {
-    if (cont.size() < 2) return false;
-    std::sort(cont.begin(), cont.end(),[&](const KeyValue &a, const KeyValue &b) {
-        return a.key.get_string() < b.key.get_string();
+///Inspect object for undefined values and set flags (see ContainerFlag::undefined_keys)
+/**
+ * @param cont object
+ * @retval true object needs transformation in text format
+ * @retval false object doesn't need transformation
+ */
+inline bool check_undefined_keys(const Container<KeyValue> &cont) {
+    if (cont.test_flag(ContainerFlag::undefined_checked)) {
+        return cont.test_flag(ContainerFlag::undefined_keys);
+    }
+    bool found = std::any_of(cont.begin(), cont.end(), [](const KeyValue &x) {
+        return !x.value.defined() || static_cast<std::string_view>(x.key) == undef_key_name;
     });
+    cont.set_flag(found?ContainerFlag::undefined_checked|ContainerFlag::undefined_keys
+                       :ContainerFlag::undefined_checked);
+    return found;
+}
+
+inline bool sort_object(Container<KeyValue> &cont) {
+    if (cont.size() < 2) {
+        check_undefined_keys(cont);
+        return false;
+    }
+    std::sort(cont.begin(), cont.end(), KeyCompare());
     auto iter = cont.begin();
     auto prev = iter;
     ++iter;
     iter = std::remove_if(iter, cont.end(), [&](const KeyValue &x) {
-       if (prev->key == x.key) return true;
+       if (KeyCompare::compare(prev->key, x.key) == 0) return true;
        ++prev;
        return false;
     });
     cont.set_size(iter);
+    check_undefined_keys(cont);
     return iter != cont.end();
 }
 
 
 
-inline Value::Value(const std::vector<Value> &arr) {init_array(arr);}
-inline Value::Value(std::vector<Value> &&arr) {init_array_move(std::move(arr));}
+inline Value::Value(const std::vector<Value> &arr, std::pmr::memory_resource *resource) {init_array(arr, resource);}
+inline Value::Value(std::vector<Value> &&arr, std::pmr::memory_resource *resource) {init_array_move(std::move(arr), resource);}
 template<size_t _Extent>
 inline Value::Value(const std::span<const Value, _Extent> &arr) {init_array(arr);}
 template<size_t _Extent>
 inline Value::Value(std::span<Value, _Extent> &&arr) {init_array_move(std::move(arr));}
 
 template<typename X>
-inline void Value::init_object(const X &obj) {
+inline void Value::init_object(const X &obj, std::pmr::memory_resource *resource) {
     if (obj.empty()) {
         _storage = Storage::empty_object;
     } else {
         _storage = Storage::object;
-        auto cont = Container<KeyValue>::create(obj.data(), obj.size()).release();;
+        auto cont = Container<KeyValue>::create(obj.data(), obj.size(), resource).release();
         _un.object = cont;
         sort_object(*cont);
     }
 
 }
 template<typename X>
-inline void Value::init_object_move(X &&obj) {
+inline void Value::init_object_move(X &&obj, std::pmr::memory_resource *resource) {
     if (obj.empty()) {
         _storage = Storage::empty_object;
     } else {
         _storage = Storage::object;
-        auto cont = Container<KeyValue>::create_move_in(obj.data(), obj.size()).release();
+        auto cont = Container<KeyValue>::create_move_in(obj.data(), obj.size(), resource).release();
         _un.object = cont;
        sort_object(*cont);
     }
@@ -1048,8 +1452,8 @@ inline Value::Value(PCustomValue custom)
 
 
 
-inline Value::Value(const std::vector<KeyValue> &arr) {init_object(arr);}
-inline Value::Value(std::vector<KeyValue> &&arr) {init_object_move(std::move(arr));}
+inline Value::Value(const std::vector<KeyValue> &arr, std::pmr::memory_resource *resource) {init_object(arr, resource);}
+inline Value::Value(std::vector<KeyValue> &&arr, std::pmr::memory_resource *resource) {init_object_move(std::move(arr), resource);}
 template<size_t _Extent>
 inline Value::Value(const std::span<const KeyValue, _Extent> &arr) {init_object(arr);}
 template<size_t _Extent>
@@ -1083,10 +1487,210 @@ inline constexpr Value::Value(Type type):_un{0} {
     }
 }
 
+namespace _details {
+
+///Hash index of keys of a large object
+/**
+ * The index is built on the first lookup and attached to the container, so it
+ * is shared by all copies of the object. Items remain sorted, the index
+ * only maps keys to positions.
+ */
+class ObjectIndex: public ContainerAttachment {
+public:
+    ///Minimal count of items of the object to build the index
+    static constexpr std::size_t min_items = 32;
+
+    static constexpr char id = 'h';
+
+    explicit ObjectIndex(const Container<KeyValue> &obj);
+
+    ///Find key
+    /**
+     * @param obj indexed object
+     * @param key key
+     * @param hash hash of the key (key_hash())
+     * @return pointer to item or nullptr if not found
+     */
+    const KeyValue *find(const Container<KeyValue> &obj, std::string_view key, std::uint64_t hash) const;
+
+    ///Retrieve index of the object
+    /**
+     * @param obj object
+     * @return index, or nullptr when the object is too small or it is
+     * allocated in an arena (attachments of arena containers would never be released)
+     */
+    static const ObjectIndex *get(const Container<KeyValue> &obj);
+
+protected:
+    struct Slot {
+        //upper half of the hash
+        std::uint32_t tag;
+        //position of the item + 1, 0 - empty slot
+        std::uint32_t pos;
+    };
+    std::vector<Slot> _slots;
+    std::size_t _mask;
+};
+
+inline ObjectIndex::ObjectIndex(const Container<KeyValue> &obj):ContainerAttachment(&id) {
+    std::size_t cap = std::bit_ceil(obj.size() * 2);
+    _slots.resize(cap, Slot{0,0});
+    _mask = cap - 1;
+    std::uint32_t pos = 0;
+    for (const KeyValue &kv: obj) {
+        std::uint64_t h = key_hash(kv.key.get_string());
+        std::size_t i = h & _mask;
+        while (_slots[i].pos) i = (i + 1) & _mask;
+        _slots[i] = {static_cast<std::uint32_t>(h >> 32), ++pos};
+    }
+}
+
+inline const KeyValue *ObjectIndex::find(const Container<KeyValue> &obj, std::string_view key, std::uint64_t hash) const {
+    std::uint32_t tag = static_cast<std::uint32_t>(hash >> 32);
+    //first occurrence is found first, as it was inserted first
+    for (std::size_t i = hash & _mask; _slots[i].pos; i = (i + 1) & _mask) {
+        if (_slots[i].tag == tag) {
+            const KeyValue *kv = obj.data() + (_slots[i].pos - 1);
+            if (kv->key.get_string() == key) return kv;
+        }
+    }
+    return nullptr;
+}
+
+inline const ObjectIndex *ObjectIndex::get(const Container<KeyValue> &obj) {
+    if (obj.size() < min_items || obj.size() >= std::numeric_limits<std::uint32_t>::max() || obj.in_arena()) return nullptr;
+    if (auto att = obj.find_attachment(&id)) return static_cast<const ObjectIndex *>(att);
+    return static_cast<const ObjectIndex *>(obj.attach(std::make_unique<ObjectIndex>(obj)));
+}
+
+}
+
+namespace _details {
+
+///Prefixes of keys of a medium sized object stored in a separate array
+/**
+ * Binary search over keys stored in the object touches a KeyValue (including
+ * the value) on every probe. This attachment contains the first 8 bytes of each key
+ * as a big-endian number, in order of items, so the search runs over a compact
+ * array and the items are accessed only for keys with the same prefix.
+ *
+ * Building the prefixes costs about as much as 3-9 binary searches, so they are built
+ * after min_lookups searches of the same container. Objects which are read only few
+ * times (parsed, few fields are read, discarded) are not affected.
+ *
+ * Large objects use ObjectIndex instead
+ */
+class KeyPrefixes: public ContainerAttachment {
+public:
+    ///Minimal count of items of the object to build the prefixes
+    static constexpr std::size_t min_items = 8;
+    ///Count of lookups without prefixes, the prefixes are built by the next lookup
+    static constexpr unsigned char min_lookups = 8;
+
+    static constexpr char id = 'p';
+
+    explicit KeyPrefixes(const Container<KeyValue> &obj):ContainerAttachment(&id) {
+        _prefixes.reserve(obj.size());
+        for (const KeyValue &kv: obj) _prefixes.push_back(prefix(kv.key.get_string()));
+    }
+
+    ///Find key
+    /**
+     * @param obj object
+     * @param key key
+     * @return pointer to item or nullptr if not found
+     */
+    const KeyValue *find(const Container<KeyValue> &obj, std::string_view key) const {
+        std::uint64_t p = prefix(key);
+        auto range = std::equal_range(_prefixes.begin(), _prefixes.end(), p);
+        const KeyValue *from = obj.data() + (range.first - _prefixes.begin());
+        const KeyValue *to = obj.data() + (range.second - _prefixes.begin());
+        auto iter = std::lower_bound(from, to, key, [](const KeyValue &a, std::string_view b){
+            return a.key.get_string() < b;
+        });
+        if (iter == to || iter->key.get_string() != key) return nullptr;
+        return iter;
+    }
+
+    ///Retrieve prefixes of the object
+    /**
+     * @param obj object
+     * @return prefixes, or nullptr when the object is too small, it is indexed
+     * by ObjectIndex, it is allocated in an arena or it has not been searched
+     * min_lookups times yet
+     */
+    static const KeyPrefixes *get(const Container<KeyValue> &obj) {
+        if (obj.size() < min_items || obj.size() >= ObjectIndex::min_items || obj.in_arena()) return nullptr;
+        if (auto att = obj.find_attachment(&id)) return static_cast<const KeyPrefixes *>(att);
+        if (!obj.count_lookup(min_lookups)) return nullptr;
+        return static_cast<const KeyPrefixes *>(obj.attach(std::make_unique<KeyPrefixes>(obj)));
+    }
+
+    ///Calculate prefix of the key
+    /**
+     * Order of prefixes follows order of keys (equal prefixes are possible)
+     */
+    static std::uint64_t prefix(std::string_view key) {
+        std::uint64_t r = 0;
+        std::size_t len = std::min<std::size_t>(key.size(), 8);
+        for (std::size_t i = 0; i < 8; ++i) {
+            r = (r << 8) | (i < len?static_cast<unsigned char>(key[i]):0);
+        }
+        return r;
+    }
+
+protected:
+    std::vector<std::uint64_t> _prefixes;
+};
+
+///Binary search of a key in an object
+inline const Value &find_key(const Container<KeyValue> &obj, const Key &key) {
+    auto iter = std::lower_bound(obj.begin(), obj.end(), key, [](const KeyValue &a, const Key &b){
+        return KeyCompare::compare(a.key, b) < 0;
+    });
+    if (iter == obj.end() || KeyCompare::compare(iter->key, key) != 0) return undefined;
+    return iter->value;
+}
+
+}
+
+inline const Value &Value::operator [](const KeyLiteral &key) const {
+    return visit([&key](const auto &item) -> const Value &{
+        using T = std::decay_t<decltype(item)>;
+        if constexpr(std::is_same_v<T, Container<KeyValue> >) {
+            if (auto index = _details::ObjectIndex::get(item)) {
+                auto kv = index->find(item, key.get_string(), key.hash());
+                return kv?kv->value:undefined;
+            }
+            if (auto prefixes = _details::KeyPrefixes::get(item)) {
+                auto kv = prefixes->find(item, key.get_string());
+                return kv?kv->value:undefined;
+            }
+            return _details::find_key(item, key.key());
+        } else if constexpr(std::is_same_v<T, AbstractCustomValue>){
+            return item[key.get_string()];
+        } else {
+            return undefined;
+        }
+    });
+}
+
 inline const Value &Value::operator [](const std::string_view &key) const {
     return visit([key](const auto &item) -> const Value &{
         using T = std::decay_t<decltype(item)>;
         if constexpr(std::is_same_v<T, Container<KeyValue> >) {
+            if (auto index = _details::ObjectIndex::get(item)) {
+                auto kv = index->find(item, key, key_hash(key));
+                return kv?kv->value:undefined;
+            }
+            if (auto prefixes = _details::KeyPrefixes::get(item)) {
+                auto kv = prefixes->find(item, key);
+                return kv?kv->value:undefined;
+            }
+            if (key.size() < static_cast<std::size_t>(Storage::short_string_top)) {
+                //short key is stored inline, no allocation
+                return _details::find_key(item, Key(key));
+            }
 
             auto iter = std::lower_bound(item.begin(), item.end(), key, [&](const auto &a, const auto &b){
                 std::string_view sa;
@@ -1193,9 +1797,16 @@ inline constexpr double Value::get_double() const {
         if constexpr(std::is_arithmetic_v<A>) {return static_cast<double>(a);}
         else if constexpr(std::is_same_v<A, std::string_view>) {
             if (a.empty()) return std::numeric_limits<double>::signaling_NaN();
-             char *end = nullptr;
-            double r= std::strtod(a.data(),&end);
-            if (end != a.data()+a.size()) {
+            //string is not terminated by zero, so strtod can't be used directly
+            double r = 0;
+            const char *end = a.data()+a.size();
+            auto res = std::from_chars(a.data(), end, r);
+            if (res.ec == std::errc::result_out_of_range && res.ptr == end) {
+                //overflow and underflow are resolved by the strtod
+                std::string tmp(a);
+                return std::strtod(tmp.c_str(), nullptr);
+            }
+            if (res.ec != std::errc() || res.ptr != end) {
                 if (a == neg_infinity) {
                     return -std::numeric_limits<double>::infinity();
                 } else if (a == infinity) {
@@ -1441,7 +2052,7 @@ inline Value &Value::merge_keys(const Value &changes) {
     while (iter1 != end1 && iter2 != end2) {
         const auto &itm1 = *iter1;
         const auto &itm2 = *iter2;
-        int c= itm1.key.compare(itm2.key);
+        int c= KeyCompare::compare(itm1.key, itm2.key);
         if (c<0) {
             *out++ = itm1;
             ++iter1;
@@ -1469,6 +2080,7 @@ inline Value &Value::merge_keys(const Value &changes) {
         }
         ++iter2;
     }
+    check_undefined_keys(*kv);
     (*this) = Value(std::move(kv));
     return *this;
 }
@@ -1751,4 +2363,80 @@ inline constexpr bool Value::operator==(const Value &other) const {
 
 constexpr Value null = nullptr;
 
+namespace _details {
+
+template<bool frozen>
+inline void change_frozen_state(const Value &v) {
+    auto change = [](const RefCounted &x) {
+        if constexpr(frozen) return x.freeze();
+        else return x.thaw();
+    };
+    //descend to containers which changed state, or which are immortal for other
+    //reason (arena). Shared subtrees are visited once
+    auto descend = [&](const RefCounted &x) {
+        return change(x) || (x.is_immortal() && !x.is_frozen());
+    };
+    std::vector<const Value *> stack = {&v};
+    while (!stack.empty()) {
+        const Value *cur = stack.back();
+        stack.pop_back();
+        if (const Container<char> *str = cur->get_text_container()) {
+            change(*str);
+            continue;
+        }
+        cur->visit([&](const auto &x) {
+            using T = std::decay_t<decltype(x)>;
+            if constexpr(std::is_same_v<T, Container<Value> >) {
+                if (x.size() && descend(x)) {
+                    for (const Value &item: x) stack.push_back(&item);
+                }
+            } else if constexpr(std::is_same_v<T, Container<KeyValue> >) {
+                if (x.size() && descend(x)) {
+                    for (const KeyValue &kv: x) {
+                        stack.push_back(&kv.key.to_value());
+                        stack.push_back(&kv.value);
+                    }
+                }
+            } else if constexpr(std::is_base_of_v<AbstractCustomValue, T>) {
+                change(x);
+            }
+        });
+    }
+}
+
+}
+
+///Freeze the value and all its subvalues
+/**
+ * Frozen containers, strings and custom values are not reference counted,
+ * copying and destroying values doesn't touch shared memory. This is useful for
+ * long-living data shared by many threads (configuration, routing tables)
+ *
+ * Frozen values are never released. Use thaw() to release them during shutdown
+ *
+ * @param v value to freeze. Shared parts which are already frozen are skipped
+ *
+ * @note Freezing is not counted. When two frozen values share a subvalue,
+ * thaw() of one of them thaws the shared subvalue too, while the other value
+ * still relies on it being frozen. Copies of the shared subvalue made while it was
+ * frozen are not counted, so they could be released too early. Freeze and thaw
+ * values, which share parts, together (for example as one array)
+ */
+inline void freeze(const Value &v) {
+    _details::change_frozen_state<true>(v);
+}
+
+///Restore reference counting of a frozen value
+/**
+ * @param v value to thaw (it should be the same value which has been frozen)
+ *
+ * @note All copies of the frozen value (and its subvalues) created after the freeze()
+ * must be destroyed before this function is called, because these copies
+ * are not counted. After the function returns, the value is released by its
+ * last reference as usual.
+ */
+inline void thaw(const Value &v) {
+    _details::change_frozen_state<false>(v);
+}
+
 }
@@ -0,0 +1,53 @@
+#include <imtjson/atomic_value.h>
+#include <imtjson/parser.h>
+#include <imtjson/serializer.h>
+#include "check.h"
+
+#include <thread>
+
+
+int main() {
+
+    using namespace json;
+
+    AtomicValue empty;
+    CHECK(!empty.load().defined());
+
+    AtomicValue cfg(parse(R"json({"version":0,"name":"configuration document"})json"));
+    CHECK_EQUAL(cfg.load()["version"].get_int(), 0);
+
+    Value prev = cfg.exchange(parse(R"json({"version":1,"name":"configuration document"})json"));
+    CHECK_EQUAL(prev["version"].get_int(), 0);
+    CHECK_EQUAL(cfg.load()["version"].get_int(), 1);
+    //no reader is active, the previous value has been released
+    CHECK_EQUAL(cfg.reclaim(), 0);
+
+    std::atomic<bool> stop = false;
+    std::atomic<bool> failed = false;
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&]{
+            int last = 0;
+            while (!stop.load()) {
+                Value v = cfg.load();
+                int ver = v["version"].get_int();
+                //versions are published in order
+                if (ver < last || v["name"].get_string() != "configuration document") failed = true;
+                last = ver;
+            }
+        });
+    }
+    for (int i = 2; i <= 1000; ++i) {
+        cfg = Value(std::vector<KeyValue>{
+            KeyValue{std::string_view("version"), i},
+            KeyValue{std::string_view("name"), Value(std::string_view("configuration document"))}
+        });
+    }
+    stop = true;
+    for (auto &t: readers) t.join();
+    CHECK(!failed.load());
+    CHECK_EQUAL(cfg.load()["version"].get_int(), 1000);
+    CHECK_EQUAL(cfg.reclaim(), 0);
+    CHECK_EQUAL(stringify(cfg), "{\"name\":\"configuration document\",\"version\":1000}");
+
+}
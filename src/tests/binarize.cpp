@@ -38,6 +38,70 @@ int main() {
     CHECK_EQUAL(stringify(res),stringify(data));
     CHECK_EQUAL(s,binarize(res));
 
+    BinaryStreamWriter wr;
+    std::string stream;
+    wr.begin_object();
+    wr.key("items");
+    wr.begin_array();
+    for (int i = 0; i < 5; ++i) {
+        wr.write(i);
+        stream.append(wr.read());
+    }
+    wr.write(data["subobject"]);
+    wr.end();
+    wr.key("empty");
+    wr.begin_array();
+    wr.end();
+    wr.key("a_first");
+    wr.write("text");
+    wr.end();
+    stream.append(wr.read());
+
+    Value streamed = unbinarize(stream);
+    CHECK_EQUAL(stringify(streamed), "{\"a_first\":\"text\",\"empty\":[],\"items\":[0,1,2,3,4,{\"abc\":-123,\"num\":123.321000000000001}]}");
+
+    BinaryParser bp;
+    for (char c: stream) {
+        if (!bp.write(std::string_view(&c, 1))) break;
+    }
+    CHECK(!bp.is_error());
+    CHECK_EQUAL(stringify(bp.get_result()), stringify(streamed));
+
+    CHECK_EXCEPTION(ParseError, unbinarize(std::string_view("\x31\x01\x10\x01\x06", 5)));
+    CHECK_EXCEPTION(ParseError, unbinarize(std::string_view("\x05\x10\x01\x06", 4)));
+
+    Value shared_cfg = {{"timeout",30},{"retries",3},{"hosts",{"a","b","c"}}};
+    std::vector<Value> records;
+    for (int i = 0; i < 100; ++i) {
+        records.push_back(Value{{"id",i},{"cfg",shared_cfg}});
+    }
+    Value doc(records);
+    std::string full = binarize(doc);
+    std::string shared = binarize(doc, SharedRefs::same_instance);
+    CHECK_LESS(shared.size(), full.size()/2);
+    Value restored = unbinarize(shared);
+    CHECK_EQUAL(stringify(restored), stringify(doc));
+    CHECK_EQUAL(&restored[0]["cfg"].get_object(), &restored[99]["cfg"].get_object());
+    CHECK_EQUAL(binarize(restored, SharedRefs::same_instance), shared);
+
+    Value copies = {Value{{"x",1},{"y",{1,2}}}, Value{{"x",1},{"y",{1,2}}}, Value{{"x",1u},{"y",{1,2.0}}}};
+    //stream with references starts with a header
+    CHECK_EQUAL(binarize(copies, SharedRefs::same_instance).size(), binarize(copies).size() + 1);
+    CHECK_EQUAL(static_cast<unsigned char>(shared[0]), BinaryType::shared_refs);
+    CHECK_NOT_EQUAL(static_cast<unsigned char>(full[0]), BinaryType::shared_refs);
+    std::string by_content = binarize(copies, SharedRefs::same_content);
+    CHECK_LESS(by_content.size(), binarize(copies).size());
+    Value restored_copies = unbinarize(by_content);
+    CHECK_EQUAL(stringify(restored_copies), stringify(copies));
+    CHECK_EQUAL(&restored_copies[0].get_object(), &restored_copies[1].get_object());
+    CHECK_NOT_EQUAL(&restored_copies[0].get_object(), &restored_copies[2].get_object());
+
+    CHECK_EXCEPTION(ParseError, unbinarize(std::string_view("\x48\x30\x01\x40\x00", 5)));
+    //reference without the header
+    CHECK_EXCEPTION(ParseError, unbinarize(std::string_view("\x30\x02\x30\x01\x10\x01\x40\x01", 8)));
+    CHECK_EQUAL(stringify(unbinarize(std::string_view("\x48\x30\x02\x30\x01\x10\x01\x40\x01", 9))), "[[1],[1]]");
+    CHECK_EXCEPTION(ParseError, unbinarize(std::string_view("\x48\x30\x01\x48\x10\x01", 6)));
+
 
 
 
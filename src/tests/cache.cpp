@@ -0,0 +1,66 @@
+#include <imtjson/value.h>
+#include <imtjson/serializer.h>
+#include <imtjson/parser.h>
+#include "check.h"
+
+
+int main() {
+
+    using namespace json;
+
+    std::vector<Value> products;
+    for (int i = 0; i < 100; ++i) {
+        products.push_back(Value{
+            {"id", i},
+            {"name", "product"},
+            {"price", i * 1.5},
+            {"tags", {"a","b","c","d","e","f","g","h"}},
+            {"removed", undefined}
+        });
+    }
+    Value catalog(products);
+    std::string expected_text = stringify(catalog);
+    std::string expected_bin = binarize(catalog);
+
+    SerializerCache cache(1024*1024, 4);
+    //CHECK_EQUAL evaluates arguments twice, results are compared with CHECK
+    CHECK(stringify(catalog, cache) == expected_text);
+    std::size_t misses = cache.misses();
+    CHECK_GREATER(misses, 0);
+    CHECK_EQUAL(cache.hits(), 0);
+    CHECK_GREATER(cache.used(), expected_text.size());
+
+    Value response = {{"catalog", catalog}, {"user", "john"}};
+    CHECK(stringify(response, cache) == stringify(response));
+    CHECK_EQUAL(cache.hits(), 1);
+    CHECK_EQUAL(cache.misses(), misses);
+
+    CHECK(binarize(catalog, cache) == expected_bin);
+    CHECK(binarize(catalog, cache) == expected_bin);
+    CHECK_EQUAL(cache.hits(), 2);
+
+    //cached content is referenced by read_segments()
+    {
+        Serializer<> gather(response);
+        gather.set_cache(cache);
+        bool found = false;
+        for (std::string_view seg: gather.read_segments()) found = found || seg == expected_text;
+        CHECK(found);
+    }
+
+    //content is released with the container
+    catalog = Value();
+    products.clear();
+    response = Value();
+    CHECK_EQUAL(cache.used(), 0);
+
+    //cache limit
+    SerializerCache small(100, 4);
+    Value big = {1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,
+                 31,32,33,34,35,36,37,38,39,40,41,42,43,44,45,46,47,48,49,50};
+    CHECK(stringify(big, small) == stringify(big));
+    CHECK(stringify(big, small) == stringify(big));
+    CHECK_EQUAL(small.hits(), 0);
+    CHECK_EQUAL(small.used(), 0);
+
+}
@@ -0,0 +1,70 @@
+#include <imtjson/value.h>
+#include <imtjson/compress.h>
+#include "check.h"
+#include <random>
+
+
+int main() {
+
+    using namespace json;
+
+    std::vector<Value> items;
+    for (int i = 0; i < 2000; ++i) {
+        std::string name = "item number " + std::to_string(i);
+        items.push_back(Value{
+            {"id", i},
+            {"name", std::string_view(name)},
+            {"tags", {"red","green","blue"}},
+            {"price", i * 0.25}
+        });
+    }
+    Value data(items);
+
+    std::string plain = binarize(data);
+    std::string packed = binarize_compressed(data);
+    CHECK_LESS(packed.size(), plain.size()/2);
+    Value res = unbinarize_compressed(packed);
+    CHECK(binarize(res) == plain);
+
+    CompressedParser<> p;
+    bool need_more = true;
+    for (std::size_t i = 0; i < packed.size() && need_more; i+=7) {
+        need_more = p.write(std::string_view(packed).substr(i, 7));
+    }
+    CHECK(!need_more);
+    CHECK(!p.is_error());
+    CHECK(binarize(p.get_result()) == plain);
+
+    CompressedSerializer ser(data, SharedRefs::none, 1000);
+    std::size_t blocks = 0;
+    std::string small_blocks;
+    for (auto part = ser.read(); !part.empty(); part = ser.read()) {
+        small_blocks.append(part);
+        ++blocks;
+    }
+    CHECK_GREATER(blocks, plain.size()/1000);
+    CHECK(binarize(unbinarize_compressed(small_blocks)) == plain);
+
+    std::mt19937 rnd(1);
+    std::string noise;
+    for (int i = 0; i < 5000; ++i) noise.push_back(static_cast<char>(rnd()));
+    Value noise_val(noise);
+    std::string packed_noise = binarize_compressed(noise_val);
+    CHECK(packed_noise[0] == (BlockType::stored | 1));
+    CHECK(unbinarize_compressed(packed_noise).get_string() == noise);
+
+    std::string corrupted = packed;
+    corrupted[5] = static_cast<char>(0xFF);
+    corrupted[6] = static_cast<char>(0xFF);
+    CHECK_EXCEPTION(ParseError, unbinarize_compressed(corrupted));
+    CHECK_EXCEPTION(ParseError, unbinarize_compressed(packed.substr(0, packed.size()/2)));
+
+    std::string long_text;
+    for (int i = 0; long_text.size() < 2*1024*1024; ++i) long_text.append("line " + std::to_string(i) + "\n");
+    Value long_val(long_text);
+    CompressedSerializer big_ser(long_val, SharedRefs::none, 4*1024*1024);
+    std::string big_blocks;
+    for (auto part = big_ser.read(); !part.empty(); part = big_ser.read()) big_blocks.append(part);
+    CHECK_EXCEPTION(ParseError, unbinarize_compressed(big_blocks));
+    CHECK(unbinarize_compressed(big_blocks, 4*1024*1024).get_string() == long_text);
+}
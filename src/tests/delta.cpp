@@ -0,0 +1,59 @@
+#include <imtjson/value.h>
+#include <imtjson/delta.h>
+#include "check.h"
+
+
+int main() {
+
+    using namespace json;
+
+    std::vector<Value> levels;
+    for (int i = 0; i < 200; ++i) {
+        levels.push_back(Value{{"price", 100+i},{"volume", i*10}});
+    }
+    Value session = {{"user","john"},{"roles",{"admin","trader"}}};
+    Value v1 = {
+        {"book", Value(levels)},
+        {"session", session},
+        {"seq", 1},
+        {"obsolete", true}
+    };
+
+    std::vector<Value> levels2 = levels;
+    levels2[50] = Value{{"price", 150},{"volume", 1}};
+    levels2.insert(levels2.begin()+100, Value{{"price", 199.5},{"volume", 7}});
+    levels2.pop_back();
+    Value v2 = {
+        {"book", Value(levels2)},
+        {"session", session},
+        {"seq", 2},
+        {"added", "text"}
+    };
+
+    std::string d = make_delta(v1, v2);
+    CHECK_LESS(d.size(), binarize(v2).size()/10);
+    Value r = apply_delta(v1, d);
+    CHECK_EQUAL(stringify(r), stringify(v2));
+    CHECK_EQUAL(&r["session"].get_object(), &v1["session"].get_object());
+    CHECK_EQUAL(&r["book"][0].get_object(), &v1["book"][0].get_object());
+    CHECK_EQUAL(&r["book"][150].get_object(), &v1["book"][149].get_object());
+
+    std::string same = make_delta(v1, v1);
+    CHECK_EQUAL(same.size(), 1);
+    CHECK_EQUAL(&apply_delta(v1, same).get_object(), &v1.get_object());
+
+    Value other = {1,2,3};
+    CHECK_EQUAL(stringify(apply_delta(v1, make_delta(v1, other))), stringify(other));
+    CHECK_EQUAL(stringify(apply_delta(other, make_delta(other, Value{1,2,3,4}))), "[1,2,3,4]");
+    CHECK_EQUAL(stringify(apply_delta(nullptr, make_delta(nullptr, 42))), "42");
+
+    CHECK_EXCEPTION(ParseError, apply_delta(v1, d.substr(0, d.size()-1)));
+    CHECK_EXCEPTION(ParseError, apply_delta(other, make_delta(v1["book"], v2["book"])));
+    Value obj_a = {{"a",1},{"b",2}};
+    Value obj_b = {{"a",1},{"b",3}};
+    CHECK_EXCEPTION(ParseError, apply_delta(other, make_delta(obj_a, obj_b)));
+    CHECK_EQUAL(stringify(apply_delta(obj_a, make_delta(obj_a, obj_b))), stringify(obj_b));
+    //corrupted counts must not cause huge allocations
+    CHECK_EXCEPTION(ParseError, apply_delta(obj_a, std::string_view("\x6F\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF", 9)));
+    CHECK_EXCEPTION(ParseError, apply_delta(other, std::string_view("\x57\0\0\0\0\x7f\xff\xff\xff", 9)));
+}
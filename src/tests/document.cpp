@@ -0,0 +1,64 @@
+#include <imtjson/value.h>
+#include <imtjson/document.h>
+#include <imtjson/serializer.h>
+#include "check.h"
+
+
+int main() {
+
+    using namespace json;
+
+    std::string_view text = R"json({"name":"document with a long string value","items":[1,2,3,{"a":[true]}],
+        "big":123456789012345678901234567890,"nested":{"x":"another long string value"}})json";
+
+    Value escaped;
+    Value escaped_wrap;
+    Value escaped_obj;
+    {
+        Document doc = Document::parse(text);
+        CHECK_EQUAL(stringify(doc.root()), stringify(parse(text)));
+        const Container<KeyValue> &obj = doc.root().get_object();
+        CHECK(obj.in_arena());
+        CHECK(obj.is_immortal());
+        CHECK(doc["name"].get_string_container()->in_arena());
+
+        //copies don't change reference counts
+        Value copy = doc["items"];
+        Document doc2 = doc;
+        CHECK(doc2["items"].get_array().in_arena());
+
+        escaped = Document::escape(doc["nested"]);
+        CHECK(!escaped.get_object().in_arena());
+        CHECK(!escaped["x"].get_string_container()->in_arena());
+        CHECK(escaped == doc["nested"]);
+
+        Value whole = escape(doc.root());
+        CHECK(whole == doc.root());
+        CHECK_EQUAL(stringify(whole), stringify(doc.root()));
+
+        Document bin = Document::unbinarize(binarize(doc.root()));
+        CHECK(bin.root() == doc.root());
+        CHECK(bin.root().get_object().in_arena());
+
+        //values outside the arena are shared by escape()
+        Value heap = {1,2,3};
+        CHECK(&escape(heap).get_array() == &heap.get_array());
+
+        //heap containers which hold values of the document are copied
+        Value wrap = {doc["name"], doc["items"], doc["big"], 5};
+        escaped_wrap = escape(wrap);
+        CHECK(&escaped_wrap.get_array() != &wrap.get_array());
+        CHECK(!escaped_wrap[1].get_array().in_arena());
+        Value wrap_obj = {{"nested", doc["nested"]}, {"plain", heap}};
+        escaped_obj = escape(wrap_obj);
+        CHECK(&escaped_obj["plain"].get_array() == &heap.get_array());
+    }
+    CHECK_EQUAL(stringify(escaped_wrap),
+        "[\"document with a long string value\",[1,2,3,{\"a\":[true]}],123456789012345678901234567890,5]");
+    CHECK_EQUAL(stringify(escaped_obj), "{\"nested\":{\"x\":\"another long string value\"},\"plain\":[1,2,3]}");
+    //escaped value survives the document
+    CHECK_EQUAL(escaped["x"].get_string(), "another long string value");
+    CHECK(!Document().root().defined());
+    CHECK_EXCEPTION(ParseError, Document::parse("[1,2"));
+
+}
@@ -0,0 +1,78 @@
+#include <imtjson/value.h>
+#include <imtjson/parser.h>
+#include <imtjson/serializer.h>
+#include <imtjson/pool.h>
+#include "check.h"
+
+#include <thread>
+
+
+int main() {
+
+    using namespace json;
+
+    std::string_view text = R"json({"name":"configuration with a long string value","routes":[
+        {"path":"/api/v1/users","target":"users-service.internal"},
+        {"path":"/api/v1/orders","target":"orders-service.internal"}],"limit":100,
+        "big":123456789012345678901234567890})json";
+
+    Value cfg = parse(text);
+    Value shared = cfg["routes"];
+    freeze(cfg);
+    CHECK(cfg.get_object().is_frozen());
+    CHECK(shared.get_array().is_frozen());
+    CHECK(shared[0]["target"].get_string_container()->is_frozen());
+    CHECK(cfg["name"].get_string_container()->is_frozen());
+    CHECK(cfg["big"].get_text_container()->is_frozen());
+    CHECK(!cfg.get_object().in_arena());
+
+    {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([cfg]{
+                for (int j = 0; j < 1000; ++j) {
+                    Value r = cfg["routes"];
+                    Value t = r[j & 1]["target"];
+                    (void)t;
+                }
+            });
+        }
+        for (auto &t: threads) t.join();
+    }
+    CHECK_EQUAL(stringify(cfg), stringify(parse(text)));
+
+    thaw(cfg);
+    CHECK(!cfg.get_object().is_frozen());
+    CHECK(!cfg["name"].get_string_container()->is_frozen());
+    CHECK(!cfg["big"].get_text_container()->is_frozen());
+    CHECK(!shared.get_array().is_frozen());
+
+    //subtree referenced twice is frozen and thawed once
+    Value obj = Value(std::vector<KeyValue>{KeyValue{std::string_view("a"), shared}, KeyValue{std::string_view("b"), shared}});
+    freeze(obj);
+    CHECK(shared.get_array().is_frozen());
+    thaw(obj);
+    CHECK(!obj.get_object().is_frozen());
+    CHECK(!shared.get_array().is_frozen());
+
+    {
+        //frozen container allocated from other resource is not an arena container
+        Value p = parse(text, &PoolResource::instance());
+        freeze(p);
+        CHECK(p.get_object().is_immortal());
+        CHECK(!p.get_object().in_arena());
+        thaw(p);
+    }
+
+    {
+        //arena containers are not frozen
+        ArenaResource arena;
+        Value a = parse(text, &arena);
+        freeze(a);
+        CHECK(!a.get_object().is_frozen());
+        CHECK(a.get_object().in_arena());
+        thaw(a);
+        CHECK(a.get_object().in_arena());
+    }
+
+}
@@ -0,0 +1,62 @@
+#include <imtjson/value.h>
+#include <imtjson/parser.h>
+#include <imtjson/serializer.h>
+#include "check.h"
+
+class CountingResource: public std::pmr::memory_resource {
+public:
+    std::size_t allocations = 0;
+    std::size_t outstanding = 0;
+protected:
+    void *do_allocate(std::size_t bytes, std::size_t align) override {
+        ++allocations;
+        outstanding += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+    void do_deallocate(void *p, std::size_t bytes, std::size_t align) override {
+        outstanding -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+int main() {
+
+    using namespace json;
+
+    std::string_view text = R"json({"name":"resource test with a long string","items":[1,2,3,{"a":[]}],
+        "nested":{"x":"another long string value"}})json";
+
+    CountingResource res;
+    {
+        Value v = parse(text, &res);
+        CHECK_EQUAL(stringify(v), stringify(parse(text)));
+        CHECK(v.get_object().get_memory_resource() == &res);
+        CHECK(v["items"].get_array().get_memory_resource() == &res);
+        CHECK(v["name"].get_string_container()->get_memory_resource() == &res);
+        CHECK_GREATER(res.allocations, 4);
+        CHECK_GREATER(res.outstanding, 0);
+
+        std::string bin = binarize(v);
+        Value w = unbinarize(bin, &res);
+        CHECK(w == v);
+    }
+    //everything has been returned to the resource
+    CHECK_EQUAL(res.outstanding, 0);
+
+    //monotonic arena
+    std::pmr::monotonic_buffer_resource arena;
+    Value a = parse(text, &arena);
+    CHECK_EQUAL(stringify(a), stringify(parse(text)));
+    a = Value();
+
+    Value s(std::string_view("string allocated in the resource"), false, &res);
+    CHECK(s.get_string_container()->get_memory_resource() == &res);
+    Value arr(std::vector<Value>{1, 2, s}, &res);
+    CHECK(arr.get_array().get_memory_resource() == &res);
+    s = arr = Value();
+    CHECK_EQUAL(res.outstanding, 0);
+
+}
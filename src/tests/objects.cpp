@@ -49,4 +49,97 @@ int main() {
     CHECK_EQUAL(arr[2]["three"].get_int(), 3);
     CHECK_EQUAL(arr[1][0].get_int(), 1);
 
+    //presence of undefined values is detected during construction
+    Value plain = {{"a", 1}, {"b", 2}};
+    CHECK(plain.get_object().test_flag(ContainerFlag::undefined_checked));
+    CHECK(!plain.get_object().test_flag(ContainerFlag::undefined_keys));
+    Value with_undef = {{"a", 1}, {"b", undefined}};
+    CHECK(with_undef.get_object().test_flag(ContainerFlag::undefined_keys));
+    plain.set_keys({{"c", 3}});
+    CHECK(plain.get_object().test_flag(ContainerFlag::undefined_checked));
+    CHECK(!plain.get_object().test_flag(ContainerFlag::undefined_keys));
+    CHECK(check_undefined_keys(Value({{undef_key_name, 1}, {"x", 2}}).get_object()));
+
+    //large objects are searched through the hash index
+    std::vector<KeyValue> items;
+    for (int i = 0; i < 1000; ++i) {
+        items.push_back(KeyValue(std::string_view("id_" + std::to_string(i)), i));
+    }
+    Value large(items);
+    CHECK(large.get_object().find_attachment(&_details::ObjectIndex::id) == nullptr);
+    CHECK_EQUAL(large["id_0"].get_int(), 0);
+    CHECK(large.get_object().find_attachment(&_details::ObjectIndex::id) != nullptr);
+    bool all_found = true;
+    for (int i = 0; i < 1000; ++i) {
+        if (large["id_" + std::to_string(i)].get_int() != i) all_found = false;
+    }
+    CHECK(all_found);
+    CHECK(!large["id_1000"].defined());
+    CHECK(!large[""].defined());
+    Value large_copy = large;
+    CHECK_EQUAL(large_copy["id_999"].get_int(), 999);
+    CHECK(obj1.get_object().find_attachment(&_details::ObjectIndex::id) == nullptr);
+    //indexed object with long keys and keys containing zeroes
+    std::vector<KeyValue> long_items = items;
+    long_items.push_back(KeyValue(std::string_view("long key of the indexed object"), "long"));
+    long_items.push_back(KeyValue(std::string_view("id\0", 3), "zero"));
+    Value long_large(long_items);
+    CHECK_EQUAL(long_large["long key of the indexed object"].get_string(), "long");
+    CHECK_EQUAL(long_large[std::string_view("id\0", 3)].get_string(), "zero");
+    CHECK(!long_large["id"].defined());
+    CHECK(!long_large["long key of the indexed object!"].defined());
+    CHECK_EQUAL(long_large["id_7"].get_int(), 7);
+
+    //order of keys matches order of strings, including inline and long keys
+    std::vector<std::string> names = {"", "a", std::string("a\0", 2), "ab", "abcdefgh",
+        "abcdefghijklmn", "abcdefghijklmno", "abcdefgh\xff", "b", "zzzzzzzzzzzzzzzzzzzz", "\xff"};
+    bool ordered = true;
+    for (const auto &x: names) for (const auto &y: names) {
+        int c = KeyCompare::compare(Key(std::string_view(x)), Key(std::string_view(y)));
+        int e = std::string_view(x).compare(y);
+        if ((c < 0) != (e < 0) || (c == 0) != (e == 0)) ordered = false;
+    }
+    CHECK(ordered);
+    std::vector<KeyValue> mixed;
+    for (auto iter = names.rbegin(); iter != names.rend(); ++iter) {
+        mixed.push_back(KeyValue(std::string_view(*iter), Value(std::string_view(*iter))));
+    }
+    Value mixed_obj(mixed);
+    CHECK_EQUAL(mixed_obj.size(), names.size());
+    CHECK(mixed_obj.get_object().find_attachment(&_details::KeyPrefixes::id) == nullptr);
+    //few lookups don't build prefixes
+    bool found = true;
+    for (unsigned int i = 0; i < _details::KeyPrefixes::min_lookups; ++i) {
+        found = found && mixed_obj["b"].get_string() == "b";
+    }
+    CHECK(found);
+    CHECK(mixed_obj.get_object().find_attachment(&_details::KeyPrefixes::id) == nullptr);
+    bool sorted = true;
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        if (mixed_obj.keys()[i].key.get_string() != names[i]) sorted = false;
+        if (mixed_obj[names[i]].get_string() != names[i]) sorted = false;
+    }
+    CHECK(sorted);
+    //medium sized object searched repeatedly is searched through prefixes of keys
+    CHECK(mixed_obj.get_object().find_attachment(&_details::KeyPrefixes::id) != nullptr);
+    CHECK(large.get_object().find_attachment(&_details::KeyPrefixes::id) == nullptr);
+    CHECK(!mixed_obj["abcdefgh\x01"].defined());
+    CHECK(!mixed_obj[std::string_view("a\0\0", 3)].defined());
+    CHECK(!mixed_obj["abc"].defined());
+    CHECK(!mixed_obj["abcdefghijklmnop"].defined());
+
+    //key literals
+    using namespace json::literals;
+    constexpr KeyLiteral lit_id = "id_500"_key;
+    static_assert(lit_id.hash() == key_hash("id_500"));
+    CHECK_EQUAL(large[lit_id].get_int(), 500);
+    CHECK(!large["id_x"_key].defined());
+    CHECK_EQUAL(obj1["three"_key].get_int(), 3);
+    CHECK_EQUAL(mixed_obj["abcdefghijklmno"_key].get_string(), "abcdefghijklmno");
+    CHECK(!mixed_obj["abcdefghijklmnop"_key].defined());
+    CHECK(!Value(1)["one"_key].defined());
+
+    static_assert(key_hash("") == 0xcbf29ce484222325ULL);
+    static_assert(key_hash("a") == 0xaf63dc4c8601ec8cULL);
+
 }
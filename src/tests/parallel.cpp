@@ -0,0 +1,46 @@
+#include <imtjson/value.h>
+#include <imtjson/parallel.h>
+#include <imtjson/parser.h>
+#include "check.h"
+
+
+int main() {
+
+    using namespace json;
+
+    std::vector<Value> items;
+    for (int i = 0; i < 20000; ++i) {
+        items.push_back({i, "item", i * 0.25, i % 7 == 0?Value(undefined):Value(true),
+                         {{"id", i}, {undef_key_name, "x"}, {"gone", undefined}}});
+    }
+    Value arr(items);
+    CHECK(stringify_parallel(arr, 4) == stringify(arr));
+    CHECK(binarize_parallel(arr, 4) == binarize(arr));
+    CHECK(stringify_parallel(arr, 3) == stringify(arr));
+
+    std::vector<KeyValue> kv;
+    for (int i = 0; i < 5000; ++i) {
+        kv.push_back(KeyValue("key" + std::to_string(i), i % 5 == 0?Value(undefined):Value(i)));
+    }
+    kv.push_back(KeyValue(std::string(undef_key_name) + "x", Value("prefix")));
+    Value obj(kv);
+    CHECK(stringify_parallel(obj, 4) == stringify(obj));
+    CHECK(binarize_parallel(obj, 4) == binarize(obj));
+
+    //slices containing undefined values only
+    std::vector<Value> undefs(10000, Value(undefined));
+    undefs.back() = 42;
+    Value sparse(undefs);
+    CHECK_EQUAL(stringify_parallel(sparse, 4), "[42]");
+    undefs.back() = undefined;
+    CHECK_EQUAL(stringify_parallel(Value(undefs), 4), "[]");
+
+    //small values are serialized at once
+    CHECK_EQUAL(serialize_parallel(Value{1,2,3}, 4).size(), 1);
+    CHECK_EQUAL(stringify_parallel("text"), "\"text\"");
+
+    auto parts = serialize_parallel<Format::binary>(arr, 4);
+    CHECK_EQUAL(parts.size(), 5);
+    CHECK(unbinarize(binarize_parallel(arr)) == arr);
+
+}
@@ -102,5 +102,17 @@ int main() {
     CHECK_EQUAL(jc1["array"][2].get_int(), 3);
     CHECK(!jc1["object"].defined());
 
+    //hash index is not built by the parser
+    std::string large_text = "{";
+    for (int i = 0; i < 100; ++i) {
+        if (i) large_text.push_back(',');
+        large_text.append("\"k" + std::to_string(i) + "\":" + std::to_string(i));
+    }
+    large_text.push_back('}');
+    Value large = parse(large_text);
+    CHECK(large.get_object().find_attachment(&_details::ObjectIndex::id) == nullptr);
+    CHECK_EQUAL(large["k42"].get_int(), 42);
+    CHECK(large.get_object().find_attachment(&_details::ObjectIndex::id) != nullptr);
+
 
 }
@@ -0,0 +1,53 @@
+#include <imtjson/value.h>
+#include <imtjson/parser.h>
+#include <imtjson/serializer.h>
+#include <imtjson/pool.h>
+#include "check.h"
+
+#include <thread>
+
+
+int main() {
+
+    using namespace json;
+
+    std::string_view text = R"json({"name":"pooled document with a long string","items":[1,2,3,{"a":[true]}],
+        "nested":{"x":"another long string value","y":[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20]}})json";
+    std::string expected = stringify(parse(text));
+
+    PoolResource &pool = PoolResource::instance();
+    for (int i = 0; i < 100; ++i) {
+        Value v = parse(text, &pool);
+        CHECK(stringify(v) == expected);
+    }
+    PoolStats st = pool.stats();
+    CHECK_GREATER(st.misses, 0);
+    CHECK_GREATER(st.hits, st.misses * 10);
+
+    //allocated by other threads, released by this thread
+    std::vector<Value> values(4);
+    {
+        std::vector<std::thread> thr;
+        for (auto &v: values) thr.emplace_back([&v, text, &pool]{
+            for (int i = 0; i < 10; ++i) v = parse(text, &pool);
+        });
+        for (auto &t: thr) t.join();
+    }
+    for (auto &v: values) CHECK(stringify(v) == expected);
+    values.clear();
+    CHECK_GREATER(pool.stats().remote_frees, 0);
+
+    //allocated by this thread, released by other running threads
+    for (int i = 0; i < 4; ++i) values.push_back(parse(text, &pool));
+    std::vector<std::thread> thr;
+    for (auto &v: values) thr.emplace_back([v = std::move(v)]() mutable {v = Value();});
+    for (auto &t: thr) t.join();
+    values.clear();
+    Value v = parse(text, &pool);
+    CHECK(stringify(v) == expected);
+
+    //large blocks are allocated from the heap
+    Value large(std::vector<Value>(1000, Value(1)), &pool);
+    CHECK_EQUAL(large.size(), 1000);
+
+}
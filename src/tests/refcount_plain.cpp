@@ -0,0 +1,41 @@
+#define IMTJSON_NON_ATOMIC_REFCOUNT
+#define IMTJSON_REFCOUNT_THREAD_CHECK
+#include <imtjson/value.h>
+#include <imtjson/parser.h>
+#include <imtjson/serializer.h>
+#include "check.h"
+#include <thread>
+
+
+int main() {
+
+    using namespace json;
+
+    static_assert(std::is_same_v<RefCounter, _details::PlainCounter>);
+
+    std::string_view text = R"json({"name":"non-atomic reference counting","items":[1,2,3,{"a":[true]}]})json";
+    Value v = parse(text);
+    std::vector<Value> copies(100, v);
+    for (auto &c: copies) CHECK(c == v);
+    copies.clear();
+    Value items = v["items"];
+    v = Value();
+    CHECK_EQUAL(stringify(items), "[1,2,3,{\"a\":[true]}]");
+    CHECK_EQUAL(stringify(parse(stringify(items))), stringify(items));
+
+    ArenaResource arena;
+    Value imm = parse("[1,2,\"string in the arena\"]", &arena);
+    Value imm_copy = imm;
+    CHECK(imm_copy.get_array().is_immortal());
+    CHECK_EQUAL(stringify(imm_copy), "[1,2,\"string in the arena\"]");
+
+    //value created by other thread is moved here, copied and released
+    Value moved;
+    std::thread thr([&]{moved = parse(text);});
+    thr.join();
+    Value moved_copy = moved;
+    CHECK_EQUAL(stringify(moved_copy["items"]), "[1,2,3,{\"a\":[true]}]");
+    moved = Value();
+    moved_copy = Value();
+
+}
@@ -1,5 +1,8 @@
 #include <imtjson/value.h>
 #include <imtjson/serializer.h>
+#include <imtjson/parser.h>
+#include <random>
+#include <cstring>
 #include "check.h"
 
 
@@ -29,7 +32,117 @@ int main() {
     };
 
     std::string s = stringify(data);
-    CHECK_EQUAL(s, "{\"\x7F\":[\"not here\"],\"abcdefgewwqeq\":[1,12.3,43.212,1.2342312e+10,0,2.225073858507e-308],\"bool1\":true,\"bool2\":false,\"inf1\":\"∞\",\"inf2\":\"-∞\",\"m1\":42,\"missing\":null,\"nan\":null,\"subobject\":{\"\x7F\":[],\"abc\":-123,\"num\":123.321000000000001,\"\x7F\x7F\":\"aaa\"},\"\x7F\x7F\":68}");
+    CHECK_EQUAL(s, "{\"\x7F\":[\"not here\"],\"abcdefgewwqeq\":[1,12.3,43.212,12342312000,0,2.2250738585072014e-308],\"bool1\":true,\"bool2\":false,\"inf1\":\"∞\",\"inf2\":\"-∞\",\"m1\":42,\"missing\":null,\"nan\":null,\"subobject\":{\"\x7F\":[],\"abc\":-123,\"num\":123.321000000000001,\"\x7F\x7F\":\"aaa\"},\"\x7F\x7F\":68}");
 
+    //doubles are rendered in the shortest form which is parsed back to the same value
+    std::mt19937_64 rnd(1);
+    for (int i = 0; i < 10000; ++i) {
+        std::uint64_t bits = rnd();
+        double x;
+        std::memcpy(&x, &bits, sizeof(x));
+        if (!std::isfinite(x)) continue;
+        std::string t = stringify(Value{x});
+        double y = parse(t)[0].get_double();
+        CHECK(std::memcmp(&x, &y, sizeof(x)) == 0);
+        double z = std::uniform_real_distribution<double>(-1e6, 1e6)(rnd);
+        CHECK_EQUAL(parse(stringify(Value{z}))[0].get_double(), z);
+    }
+    CHECK_EQUAL(stringify(Value{0.1, -2.5, 1e300, 5e-324}), "[0.1,-2.5,1e+300,5e-324]");
+
+    std::uint64_t pw = 1;
+    for (int i = 0; i < 20; ++i) {
+        for (std::uint64_t n: {pw - 1, pw, pw + 1}) {
+            CHECK_EQUAL(stringify(Value(n)), std::to_string(n));
+            auto neg = -static_cast<std::int64_t>(n >> 1);
+            CHECK_EQUAL(stringify(Value(neg)), std::to_string(neg));
+            CHECK(unbinarize(binarize(Value(n))).get_unsigned_long_long() == n);
+        }
+        if (i < 19) pw *= 10;
+    }
+    CHECK_EQUAL(stringify(Value(std::numeric_limits<std::uint64_t>::max())), "18446744073709551615");
+    CHECK_EQUAL(stringify(Value(std::numeric_limits<std::int64_t>::min())), "-9223372036854775808");
+
+    CHECK_EQUAL(stringify("a\"b\\c\bd\fe\nf\rg\th\x01"), R"("a\"b\\c\bd\fe\nf\rg\th\u0001")");
+    std::string long_text(100, 'x');
+    long_text[70] = '\r';
+    long_text[71] = '\x1F';
+    Value long_str(long_text);
+    CHECK_EQUAL(stringify(long_str), "\"" + long_text.substr(0, 70) + "\\r\\u001F" + long_text.substr(72) + "\"");
+    CHECK(!long_str.get_string_container()->test_flag(ContainerFlag::clean_text));
+    Value clean_str(std::string(100, 'y') + "\x7F\xC4\x8D");
+    std::string clean_text = stringify(clean_str);
+    CHECK(clean_str.get_string_container()->test_flag(ContainerFlag::clean_text));
+    CHECK_EQUAL(stringify(clean_str), clean_text);
+    CHECK_EQUAL(parse(clean_text).get_string(), clean_str.get_string());
+    for (std::size_t i = 0; i < long_text.size(); ++i) {
+        std::string s(long_text.size(), 'z');
+        s[i] = i & 1?'"':'\\';
+        CHECK_EQUAL(parse(stringify(Value(s))).get_string(), s);
+    }
+
+    std::vector<Value> items;
+    for (int i = 0; i < 5000; ++i) items.push_back({i, "item", true});
+    Value big(items);
+    std::string big_text = stringify(big);
+    std::size_t chunks = 0;
+    std::string collected;
+    serialize_to(big, [&](std::string_view part){
+        collected.append(part);
+        ++chunks;
+    }, 4096);
+    CHECK_EQUAL(collected, big_text);
+    CHECK_BETWEEN(big_text.size()/4200, chunks, big_text.size()/4096+1);
+
+    char small[10];
+    CHECK_EQUAL(serialize_to(data, small), s.size());
+    CHECK_EQUAL(std::string_view(small, sizeof(small)), s.substr(0, sizeof(small)));
+    std::vector<char> exact(big_text.size());
+    CHECK_EQUAL(serialize_to(big, exact), big_text.size());
+    CHECK(std::string_view(exact.data(), exact.size()) == big_text);
+
+    std::string appended = "prefix";
+    serialize_to<Format::binary>(big, appended);
+    CHECK(appended.substr(6) == binarize(big));
+
+    Value payload(std::string(1000, 'p'));
+    Value escaped(std::string(1000, '"'));
+    Value doc = {{"payload", payload}, {"escaped", escaped}, {"items", big}};
+    auto gather = [&](auto &ser) {
+        std::string out;
+        bool referenced = false;
+        for (auto segs = ser.read_segments(); !segs.empty(); segs = ser.read_segments()) {
+            for (std::string_view seg: segs) {
+                referenced = referenced || seg.data() == payload.get_string_container()->data();
+                out.append(seg);
+            }
+        }
+        CHECK(referenced);
+        return out;
+    };
+    Serializer<> text_ser(doc, SharedRefs::none, 4096);
+    CHECK(gather(text_ser) == stringify(doc));
+    BinarySerializer bin_ser(doc, SharedRefs::none, 4096);
+    CHECK(gather(bin_ser) == binarize(doc));
+
+    Value sized = {{"doc", doc}, {"numbers", {0, -1, 1.5, -0.0, 1e300, std::numeric_limits<double>::infinity(),
+                    std::numeric_limits<long long>::min(), std::numeric_limits<unsigned long long>::max()}},
+                   {"ctl", "a\"b\\c\n\x01\x1F"}, {"num", Value("123.5", true)}, {"empty", Value(Type::array)},
+                   {"undef", undefined}, {undef_key_name, {undefined, nullptr}}, {"bool", false}};
+    CHECK_EQUAL(serialized_size(sized), stringify(sized).size());
+    CHECK_EQUAL(serialized_size<Format::binary>(sized), binarize(sized).size());
+    CHECK_EQUAL(serialized_size(sized, true), stringify(sized).size());
+    CHECK_EQUAL(serialized_size(sized, true), stringify(sized).size());
+    CHECK_EQUAL(serialized_size<Format::binary>(sized, true), binarize(sized).size());
+    CHECK_EQUAL(serialized_size(Value()), stringify(Value()).size());
+
+    //long runs of undefined values and deep nesting don't use recursion
+    std::vector<Value> holes(1000000, Value(undefined));
+    holes.push_back(1);
+    CHECK_EQUAL(stringify(Value(holes)), "[1]");
+    Value deep = 1;
+    for (int i = 0; i < 10000; ++i) deep = Value{deep};
+    std::string deep_text = stringify(deep);
+    CHECK_EQUAL(deep_text.size(), 20001);
+    CHECK_EQUAL(deep_text.substr(9998, 5), "[[1]]");
 
 }
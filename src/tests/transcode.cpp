@@ -0,0 +1,105 @@
+#include <imtjson/value.h>
+#include <imtjson/transcoder.h>
+#include "check.h"
+
+
+int main() {
+
+    using namespace json;
+
+    std::string_view text = R"json(
+    {
+        "name": "transcoder test \"quoted\" č",
+        "values": [1, -2, 3.25, 1e10, true, false, null, [], {}],
+        "nested": {"z": [{"b":1,"a":2}], "a": "x"},
+        "long_text": "this string is long enough to be allocated on the heap",
+        "empty": ""
+    }
+    )json";
+
+    Value v = parse(text);
+
+    std::string bin = transcode_to_binary(text);
+    CHECK_EQUAL(stringify(unbinarize(bin)), stringify(v));
+    std::string bin_ordered = transcode_to_binary(text, true);
+    CHECK_EQUAL(stringify(unbinarize(bin_ordered)), stringify(v));
+    CHECK_LESS(bin_ordered.find("name"), bin_ordered.find("empty"));
+
+    //feed text byte by byte
+    TextToBinary t2b(true);
+    std::string chunked;
+    bool need_more = true;
+    for (std::size_t i = 0; i < text.size() && need_more; ++i) {
+        need_more = t2b.write(text.substr(i, 1));
+        chunked.append(t2b.read());
+    }
+    CHECK(!need_more);
+    CHECK(!t2b.is_error());
+    CHECK(chunked == bin_ordered);
+
+    //binary to text generates the same text as the serializer
+    std::string bin_sized = binarize(v);
+    CHECK_EQUAL(transcode_to_text(bin_sized), stringify(v));
+    std::string text_ordered = transcode_to_text(bin_ordered);
+    CHECK_EQUAL(stringify(parse(text_ordered)), stringify(v));
+    CHECK_LESS(text_ordered.find("name"), text_ordered.find("empty"));
+    CHECK_EQUAL(transcode_to_text(binarize(Value{1, undefined, 2})), "[1,2]");
+    CHECK_EQUAL(transcode_to_text(binarize(Value{{"a", undefined},{"b", 2}})), R"({"b":2})");
+
+    BinaryToText b2t;
+    std::string text_out;
+    need_more = true;
+    for (std::size_t i = 0; i < bin_sized.size() && need_more; ++i) {
+        need_more = b2t.write(std::string_view(bin_sized).substr(i, 1));
+        text_out.append(b2t.read());
+    }
+    CHECK(!need_more);
+    CHECK(!b2t.is_error());
+    CHECK_EQUAL(text_out, stringify(v));
+
+    //large object-rooted document, nested containers are transcoded without the parser
+    std::string large = "{\"records\":[";
+    for (int i = 0; i < 5000; ++i) {
+        if (i) large.push_back(',');
+        large.append("{\"z\":" + std::to_string(i) + ",\"id\":\"record " + std::to_string(i)
+                   + "\",\"tags\":[\"a\",\"b\"],\"id\":0}");
+    }
+    large.append("],\"count\":5000,\"a\":{}}");
+    TextToBinary large_t2b;
+    std::string large_bin;
+    need_more = true;
+    for (std::size_t i = 0; i < large.size() && need_more; i += 997) {
+        need_more = large_t2b.write(std::string_view(large).substr(i, 997));
+        large_bin.append(large_t2b.read());
+    }
+    CHECK(!need_more);
+    CHECK(!large_t2b.is_error());
+    Value large_v = unbinarize(large_bin);
+    CHECK(stringify(large_v) == stringify(parse(large)));
+    CHECK_EQUAL(large_v["records"][7]["id"].get_string(), "record 7");
+    CHECK_EQUAL(stringify(unbinarize(transcode_to_binary(R"({"b":[1,{"d":1,"c":2}],"a":1,"b":2})"))),
+                R"({"a":1,"b":[1,{"c":2,"d":1}]})");
+
+    //first of many duplicate keys is kept
+    std::string dups = "{";
+    for (int i = 0; i < 41; ++i) dups.append((i?",\"k\":":"\"k\":") + std::to_string(i));
+    dups.append("}");
+    Value dups_v = unbinarize(transcode_to_binary(dups));
+    CHECK_EQUAL(dups_v.size(), 1);
+    CHECK_EQUAL(dups_v["k"].get_int(), 0);
+    //the marker of undefined keys is kept as ordinary key
+    Value undef_v = unbinarize(transcode_to_binary(R"({"\u007f":["x"],"x":1})"));
+    CHECK_EQUAL(undef_v.size(), 2);
+    CHECK_EQUAL(undef_v["x"].get_int(), 1);
+    CHECK_EQUAL(undef_v[undef_key_name][0].get_string(), "x");
+
+    CHECK_EXCEPTION(ParseError, transcode_to_binary("[1,2,}"));
+    CHECK_EXCEPTION(ParseError, transcode_to_binary("{\"a\":1,}"));
+    CHECK_EXCEPTION(ParseError, transcode_to_binary("{\"a\" 1}"));
+    CHECK_EXCEPTION(ParseError, transcode_to_binary("[-]"));
+    CHECK_EXCEPTION(ParseError, transcode_to_binary("[1,2"));
+    Value shared = {1,2};
+    CHECK_EXCEPTION(ParseError, transcode_to_text(binarize(Value{shared, shared}, SharedRefs::same_instance)));
+    CHECK_EXCEPTION(ParseError, transcode_to_text(std::string_view("\x31\x02\x10", 3)));
+
+}